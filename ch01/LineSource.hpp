@@ -0,0 +1,179 @@
+#ifndef LINE_SOURCE_HPP
+#define LINE_SOURCE_HPP
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define LINE_SOURCE_X86
+#endif
+
+// Find the first newline in [p, end) 32 bytes at a time. Returns end if there
+// is none.
+#ifdef LINE_SOURCE_X86
+__attribute__((target("avx2")))
+inline const char* findNewlineAVX2(const char* p, const char* end) {
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	for (; p + 32 <= end; p += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i*)p);
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+
+		if (mask != 0) return p + __builtin_ctz(mask);
+	}
+
+	const char* q = (const char*)memchr(p, '\n', end - p);
+	return q != NULL ? q : end;
+}
+
+// Find the first newline in [p, end) 16 bytes at a time. SSE2 is part of the
+// x86-64 baseline (32-bit x86 uses it only when built with -msse2), so this
+// is the fallback when AVX2 is missing.
+inline const char* findNewlineSSE2(const char* p, const char* end) {
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	for (; p + 16 <= end; p += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)p);
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+		if (mask != 0) return p + __builtin_ctz(mask);
+	}
+
+	const char* q = (const char*)memchr(p, '\n', end - p);
+	return q != NULL ? q : end;
+}
+#endif
+
+// Scalar fallback for other architectures
+inline const char* findNewlineScalar(const char* p, const char* end) {
+	const char* q = (const char*)memchr(p, '\n', end - p);
+	return q != NULL ? q : end;
+}
+
+// Pick the widest newline kernel the CPU supports, once
+inline const char* findNewline(const char* p, const char* end) {
+#ifdef LINE_SOURCE_X86
+	static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+	return hasAVX2 ? findNewlineAVX2(p, end) : findNewlineSSE2(p, end);
+#else
+	return findNewlineScalar(p, end);
+#endif
+}
+
+// Reads the lines of a memory-mapped file as string_views into the mapping.
+// Lines follow getline: the newline is dropped and a last line without one is
+// still returned. The views stay valid for as long as the LineSource lives.
+class LineSource {
+public:
+	int fd;
+	const char* data;
+	size_t length;
+	size_t pos;
+
+	// Start offset of each line, filled in by buildIndex()
+	std::vector<size_t> offsets;
+
+	LineSource(const char* path) : fd(-1), data(NULL), length(0), pos(0) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) return;
+
+		// A file that cannot be examined, or is not a regular file (such as a
+		// directory), is closed again so isOpen() reports it
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			close(fd);
+			fd = -1;
+			return;
+		}
+		length = st.st_size;
+
+		// An empty file cannot be mapped, but is still a valid (empty) source
+		if (length == 0) return;
+
+		void* m = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (m == MAP_FAILED) {
+			close(fd);
+			fd = -1;
+			length = 0;
+			return;
+		}
+
+		// Lines are read front to back
+		madvise(m, length, MADV_SEQUENTIAL);
+		data = (const char*)m;
+	}
+
+	~LineSource() {
+		if (data != NULL) munmap((void*)data, length);
+		if (fd >= 0) close(fd);
+	}
+
+	LineSource(const LineSource&) = delete;
+	LineSource& operator=(const LineSource&) = delete;
+
+	bool isOpen() {
+		return fd >= 0 && (data != NULL || length == 0);
+	}
+
+	// True once every line has been read
+	bool eof() {
+		return pos >= length;
+	}
+
+	// === READING ===
+
+	// Read the next line into `line`. Returns false when there are no more.
+	bool next(std::string_view& line) {
+		if (pos >= length) return false;
+
+		const char* start = data + pos;
+		const char* nl = findNewline(start, data + length);
+
+		line = std::string_view(start, nl - start);
+		pos = nl - data + 1;
+		return true;
+	}
+
+	// Start reading from the first line again
+	void rewind() {
+		pos = 0;
+	}
+
+	// === RANDOM ACCESS ===
+
+	// Record the start of every line so line(k) runs in constant time. Uses
+	// the same newline kernel as next().
+	void buildIndex() {
+		offsets.clear();
+
+		for (size_t p = 0; p < length; ) {
+			offsets.push_back(p);
+			p = findNewline(data + p, data + length) - data + 1;
+		}
+	}
+
+	// Number of lines, once buildIndex() has been called
+	size_t lineCount() {
+		return offsets.size();
+	}
+
+	// Return line k (counting from 0), once buildIndex() has been called
+	std::string_view line(size_t k) {
+		size_t start = offsets[k];
+		size_t end = k + 1 < offsets.size() ? offsets[k + 1] - 1 : length;
+
+		// The last line may or may not end in a newline
+		if (end > start && data[end - 1] == '\n') end--;
+
+		return std::string_view(data + start, end - start);
+	}
+};
+
+#endif // LINE_SOURCE_HPP
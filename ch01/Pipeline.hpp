@@ -0,0 +1,264 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "../ch02/chapter-examples/ArrayQueue.hpp"
+#include "../common/Benchmark.hpp"
+#include "../common/OutputWriter.hpp"
+#include "LineSource.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Lines are passed between threads in batches, as views into the LineSource
+typedef std::vector<std::string_view> LineBatch;
+
+// Bounded, blocking queue of batches built on ArrayQueue. push() blocks while
+// the queue is full, so a slow stage holds back the stages in front of it.
+class BatchQueue {
+public:
+	ArrayQueue<LineBatch*> q;
+	int capacity;
+	bool closed;
+	std::mutex lock;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+
+	BatchQueue(int capacity0) : capacity(capacity0), closed(false) {}
+
+	void push(LineBatch* batch) {
+		std::unique_lock<std::mutex> guard(lock);
+		notFull.wait(guard, [this]() { return q.size() < capacity; });
+
+		q.add(batch);
+		notEmpty.notify_one();
+	}
+
+	// Returns NULL once the queue is closed and every batch has been taken
+	LineBatch* pop() {
+		std::unique_lock<std::mutex> guard(lock);
+		notEmpty.wait(guard, [this]() { return q.size() > 0 || closed; });
+
+		if (q.size() == 0) return NULL;
+
+		LineBatch* batch = q.remove();
+		notFull.notify_one();
+		return batch;
+	}
+
+	// Called by the producer after its last batch
+	void close() {
+		std::lock_guard<std::mutex> guard(lock);
+		closed = true;
+		notEmpty.notify_all();
+	}
+};
+
+// A transformation applied to the lines flowing through a pipeline. Each stage
+// runs on its own thread, so it may keep state between batches.
+class Stage {
+public:
+	std::string name;
+
+	// Throughput counters, reported by Pipeline::printStats()
+	long linesIn;
+	long linesOut;
+	long batches;
+	double busySeconds;
+
+	Stage(std::string name0) : name(name0), linesIn(0), linesOut(0), batches(0), busySeconds(0) {}
+
+	virtual ~Stage() {}
+
+	// Append the result of transforming `in` to `out`
+	virtual void process(LineBatch& in, LineBatch& out) = 0;
+
+	// Append any lines still held back once the input has ended
+	virtual void finish(LineBatch&) {}
+};
+
+// Reverses each block of `window` lines (ex01-01 part02)
+class ReverseWindowStage : public Stage {
+public:
+	size_t window;
+	LineBatch held;
+
+	ReverseWindowStage(size_t window0) : Stage("reverse"), window(window0) {}
+
+	void process(LineBatch& in, LineBatch& out) {
+		for (size_t i = 0; i < in.size(); i++) {
+			held.push_back(in[i]);
+
+			if (held.size() == window) finish(out);
+		}
+	}
+
+	void finish(LineBatch& out) {
+		out.insert(out.end(), held.rbegin(), held.rend());
+		held.clear();
+	}
+};
+
+// Drops every line that has already been seen (ex01-01 part04)
+class DedupStage : public Stage {
+public:
+	std::unordered_set<std::string_view> seen;
+
+	DedupStage() : Stage("dedup") {}
+
+	void process(LineBatch& in, LineBatch& out) {
+		for (size_t i = 0; i < in.size(); i++) {
+			if (seen.insert(in[i]).second) out.push_back(in[i]);
+		}
+	}
+};
+
+// Keeps the lines containing `pattern`. An empty pattern keeps non-empty lines.
+class FilterStage : public Stage {
+public:
+	std::string pattern;
+
+	FilterStage(std::string pattern0) : Stage("filter"), pattern(pattern0) {}
+
+	void process(LineBatch& in, LineBatch& out) {
+		for (size_t i = 0; i < in.size(); i++) {
+			bool keep = pattern.empty() ? !in[i].empty()
+			                            : in[i].find(pattern) != std::string_view::npos;
+			if (keep) out.push_back(in[i]);
+		}
+	}
+};
+
+// Keeps line number l (counting from 1) when l % k == part (ex01-01 part08)
+class PartitionStage : public Stage {
+public:
+	long k;
+	long part;
+	long lineNumber;
+
+	PartitionStage(long k0, long part0) : Stage("partition"), k(k0), part(part0), lineNumber(0) {}
+
+	void process(LineBatch& in, LineBatch& out) {
+		for (size_t i = 0; i < in.size(); i++) {
+			if (++lineNumber % k == part) out.push_back(in[i]);
+		}
+	}
+};
+
+// Runs a reader, a chain of stages and a writer, each on its own thread and
+// connected by bounded BatchQueues
+class Pipeline {
+public:
+	std::vector<Stage*> stages;
+	size_t batchSize;
+	int queueDepth;
+
+	Pipeline(size_t batchSize0 = 4096, int queueDepth0 = 8)
+		: batchSize(batchSize0), queueDepth(queueDepth0) {}
+
+	~Pipeline() {
+		for (size_t s = 0; s < stages.size(); s++) {
+			delete stages[s];
+		}
+	}
+
+	// Append a stage; the pipeline takes ownership of it
+	void add(Stage* stage) {
+		stages.push_back(stage);
+	}
+
+	void run(LineSource& source, OutputWriter& out) {
+		// Queue s feeds stage s; the last queue feeds the writer
+		std::vector<BatchQueue*> queues;
+		for (size_t s = 0; s <= stages.size(); s++) {
+			queues.push_back(new BatchQueue(queueDepth));
+		}
+
+		std::vector<std::thread> threads;
+
+		// Reader: cut the input into batches
+		threads.emplace_back([this, &source, &queues]() {
+			std::string_view line;
+			LineBatch* batch = new LineBatch();
+
+			while (source.next(line)) {
+				batch->push_back(line);
+
+				if (batch->size() == batchSize) {
+					queues[0]->push(batch);
+					batch = new LineBatch();
+				}
+			}
+
+			queues[0]->push(batch);
+			queues[0]->close();
+		});
+
+		// Stages: transform each batch into a new one for the next queue
+		for (size_t s = 0; s < stages.size(); s++) {
+			threads.emplace_back([this, s, &queues]() {
+				Stage* stage = stages[s];
+				LineBatch* in;
+
+				while ((in = queues[s]->pop()) != NULL) {
+					LineBatch* result = new LineBatch();
+					result->reserve(in->size());
+
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					stage->process(*in, *result);
+					stage->busySeconds += secondsSince(start);
+
+					stage->linesIn += in->size();
+					stage->linesOut += result->size();
+					stage->batches++;
+
+					delete in;
+					queues[s + 1]->push(result);
+				}
+
+				LineBatch* rest = new LineBatch();
+				stage->finish(*rest);
+				stage->linesOut += rest->size();
+
+				queues[s + 1]->push(rest);
+				queues[s + 1]->close();
+			});
+		}
+
+		// Writer: print the batches leaving the last stage
+		LineBatch* batch;
+		while ((batch = queues.back()->pop()) != NULL) {
+			for (size_t i = 0; i < batch->size(); i++) {
+				out.writeLine((*batch)[i]);
+			}
+			delete batch;
+		}
+		out.flush();
+
+		for (size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+
+		for (size_t q = 0; q < queues.size(); q++) {
+			delete queues[q];
+		}
+	}
+
+	// Report each stage's throughput while it was busy
+	void printStats() {
+		for (size_t s = 0; s < stages.size(); s++) {
+			Stage* stage = stages[s];
+			double rate = stage->busySeconds > 0 ? stage->linesIn / stage->busySeconds : 0;
+
+			fprintf(stderr, "%-10s %10ld lines in %10ld lines out %8ld batches %12.0f lines/s\n",
+			        stage->name.c_str(), stage->linesIn, stage->linesOut, stage->batches, rate);
+		}
+	}
+};
+
+#endif // PIPELINE_HPP
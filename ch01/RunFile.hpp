@@ -0,0 +1,73 @@
+#ifndef RUN_FILE_HPP
+#define RUN_FILE_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include <sys/types.h>
+
+// Most temporary files a tool keeps open at once. The usual limit is 1024
+// descriptors per process, so merges and scatters open at most this many and
+// work in several passes when they need more.
+const size_t maxOpenRuns = 256;
+
+// An anonymous temporary file of lines, written once and then read back from
+// the start. Lines are read with getline, so they keep any NUL bytes. Failures
+// are reported to the caller, which decides how the tool exits.
+class RunFile {
+public:
+	FILE* f;
+	char* buffer;
+	size_t capacity;
+
+	// Check isOpen() before using the file
+	RunFile() : f(tmpfile()), buffer(NULL), capacity(0) {}
+
+	// The file is deleted once closed
+	~RunFile() {
+		free(buffer);
+		if (f != NULL) fclose(f);
+	}
+
+	RunFile(const RunFile&) = delete;
+	RunFile& operator=(const RunFile&) = delete;
+
+	// False if the temporary file could not be created
+	bool isOpen() {
+		return f != NULL;
+	}
+
+	// Write a line and its newline. A failed write is reported by rewind().
+	void writeLine(std::string_view line) {
+		fwrite(line.data(), 1, line.size(), f);
+		fputc('\n', f);
+	}
+
+	// Go back to the first line, to read what was written. Returns false if
+	// any line failed to reach the file.
+	bool rewind() {
+		bool written = fflush(f) == 0 && !ferror(f);
+		::rewind(f);
+		return written;
+	}
+
+	// Read the next line into `line`, without its newline. The view stays
+	// valid until the next call. Returns false when there are no more, or
+	// when reading fails (see failed()).
+	bool next(std::string_view& line) {
+		ssize_t len = getline(&buffer, &capacity, f);
+		if (len < 0) return false;
+
+		if (len > 0 && buffer[len - 1] == '\n') len--;
+		line = std::string_view(buffer, len);
+		return true;
+	}
+
+	// True if next() stopped because reading failed, not at the last line
+	bool failed() {
+		return ferror(f) != 0;
+	}
+};
+
+#endif // RUN_FILE_HPP
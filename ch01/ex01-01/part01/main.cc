@@ -1,36 +1,27 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
 #include <iostream>
-#include <fstream>
-#include <stack>
-#include <string>
 using namespace std;
 
-int main() {
-	string line;
-	stack<string> lines;
-	ifstream file;
+int main(int argc, char* argv[]) {
+	// Map the file from disk (the path may be given on the command line)
+	LineSource file(argc > 1 ? argv[1] : "../../text.txt");
 
-	// Open file from disk
-	file.open("../../text.txt");
+	OutputWriter out;
 
 	// Check if file is open for reading operation
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 1;
 	}
 
-	// Read each line from file and push it onto the stack
-	while (getline(file, line)) {
-		lines.push(line);
-	}
-
-	// Close the file
-	file.close();
+	// Index where each line starts, instead of stacking a view of every line
+	file.buildIndex();
 
-	// Pop each element off the stack
-	while (!lines.empty()) {
-		std::cout << lines.top() << std::endl;
-		lines.pop();
+	// Write the lines from the last to the first
+	for (size_t k = file.lineCount(); k-- > 0; ) {
+		out.writeLine(file.line(k));
 	}
 
-	return 0;
+	return out.finish();
 }
@@ -1,36 +1,38 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
 #include <iostream>
-#include <fstream>
 #include <stack>
-#include <string>
+#include <string_view>
 using namespace std;
 
-int main() {
-	string line;
-	stack<string> lines;
-	ifstream file;
+int main(int argc, char* argv[]) {
+	string_view line;
+	stack<string_view> lines;
 
-	// Open file from disk
-	file.open("../../text.txt");
+	// Map the file from disk (the path may be given on the command line)
+	LineSource file(argc > 1 ? argv[1] : "../../text.txt");
+
+	OutputWriter out;
 
 	// Track lines of file
 	int lineCount = 0;
 	const int maxLines = 50;
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 1;
 	}
 
 	// Read the first 50 lines from the file and push them onto the stack
-	while (getline(file, line)) {
+	while (file.next(line)) {
 		lines.push(line);
 		lineCount++;
 
 		// When 50 lines are read or end of file is reached
 		if (lineCount == maxLines || file.eof()) {
 			while (!lines.empty()) {
-				std::cout << lines.top() << std::endl;
+				out.writeLine(lines.top());
 				lines.pop();
 			}
 
@@ -42,7 +44,5 @@ int main() {
 		}
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return out.finish();
 }
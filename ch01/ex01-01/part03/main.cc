@@ -1,30 +1,32 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
 #include <iostream>
-#include <fstream>
 #include <queue>
-#include <string>
+#include <string_view>
 using namespace std;
 
-int main() {
-	string line;
-	queue<string> lines;
-	ifstream file;
+int main(int argc, char* argv[]) {
+	string_view line;
+	queue<string_view> lines;
 
-	// Open file from disk
-	file.open("../../text2.txt");
+	// Map the file from disk (the path may be given on the command line)
+	LineSource file(argc > 1 ? argv[1] : "../../text2.txt");
+
+	OutputWriter out;
 
 	// Track lines of file
 	int lineCount = 0;
 	const int maxLines = 42;
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 1;
 	}
 
 
 	// Read the lines from the file
-	while (getline(file, line)) {
+	while (file.next(line)) {
 		lineCount++;
 		lines.push(line);
 
@@ -35,22 +37,20 @@ int main() {
 			// Check if line is empty and print either the line
 			// or line at front of stack.
 			if (!line.empty()) {
-				std::cout << line << std::endl;
+				out.writeLine(line);
 			} else {
-				std::cout << lines.front() << std::endl;
+				out.writeLine(lines.front());
 			}
 
 			// Dequeue oldest line
 			lines.pop();
 		} else {
-			std::cout << line << std::endl;
+			out.writeLine(line);
 		}
 
 		// Break from loop if end of file
 		if (file.eof()) break;
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return out.finish();
 }
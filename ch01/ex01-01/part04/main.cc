@@ -1,38 +1,38 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
 #include <iostream>
-#include <fstream>
 #include <set>
-#include <string>
+#include <string_view>
 using namespace std;
 
-int main() {
-	string line;
-	set<string> lines;
-	ifstream file;
+int main(int argc, char* argv[]) {
+	string_view line;
+	set<string_view> lines;
 
-	// Open file from disk
-	file.open("../../text3.txt");
+	// Map the file from disk (the path may be given on the command line)
+	LineSource file(argc > 1 ? argv[1] : "../../text3.txt");
+
+	OutputWriter out;
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 1;
 	}
 
 
 	// Read the lines from the file
-	while (getline(file, line)) {
+	while (file.next(line)) {
 		// Check if the set contains the current line
 		if (lines.find(line) == lines.end()) {
 			// If the set doesn't contain the line, insert and write to output
 			lines.insert(line);
-			std::cout << line << std::endl;
+			out.writeLine(line);
 		}
 
 		// Break from loop if end of file
 		if (file.eof()) break;
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return out.finish();
 }
@@ -1,33 +1,35 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
 #include <algorithm>
-#include <fstream>
 #include <iostream>
-#include <string>
+#include <string_view>
 #include <vector>
 using namespace std;
 
-bool compareLength(const string& a, const string& b) {
+bool compareLength(const string_view& a, const string_view& b) {
 	return a.length() < b.length();
 }
 
-int main() {
-	string line;
-	vector<string> lines;
-	ifstream file;
+int main(int argc, char* argv[]) {
+	string_view line;
+	vector<string_view> lines;
 
-	// Open file from disk
-	file.open("../../text3.txt");
+	// Map the file from disk (the path may be given on the command line)
+	LineSource file(argc > 1 ? argv[1] : "../../text3.txt");
+
+	OutputWriter out;
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 0;
 	}
 
 	// Read the lines from the file
-	while (getline(file, line)) {
+	while (file.next(line)) {
 		if (lines.size() > 1) {
 			// Skip line if already contained in vector to avoid duplicates
-			vector<string>::iterator it = find(lines.begin(), lines.end(), line);
+			vector<string_view>::iterator it = find(lines.begin(), lines.end(), line);
 
 			if (it != lines.end()) continue;
 		}
@@ -40,11 +42,9 @@ int main() {
 	sort(lines.begin(), lines.end(), compareLength);
 
 	// Print the lines, sorted by length, without duplicates
-	for (int i = 0; i < lines.size(); i++) {
-		std::cout << lines[i] << std::endl;
+	for (size_t i = 0; i < lines.size(); i++) {
+		out.writeLine(lines[i]);
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return out.finish();
 }
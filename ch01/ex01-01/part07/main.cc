@@ -1,42 +1,249 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
+#include "../../RunFile.hpp"
 #include <algorithm>
-#include <fstream>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <queue>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 using namespace std;
 
-bool compareLength(const string& a, const string& b) {
+// Default memory budget for lines held in memory (in megabytes)
+const size_t defaultBudgetMB = 256;
+
+bool compareLength(const string_view& a, const string_view& b) {
 	return a.length() < b.length();
 }
 
-int main() {
+// Approximate number of bytes a line occupies while held in a run
+size_t lineBytes(const string_view& line) {
+	return sizeof(string_view) + line.length();
+}
+
+// Sort each run by length in parallel, one thread per run. stable_sort keeps
+// lines of equal length in their original order.
+void sortRuns(vector<vector<string_view>>& runs) {
+	vector<thread> workers;
+
+	for (size_t r = 0; r < runs.size(); r++) {
+		workers.emplace_back([&runs, r]() {
+			stable_sort(runs[r].begin(), runs[r].end(), compareLength);
+		});
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+}
+
+// Write a sorted run to an anonymous temporary file and rewind it for
+// merging. Returns NULL if the file could not be created or written.
+RunFile* spillRun(const vector<string_view>& run) {
+	RunFile* f = new RunFile();
+
+	if (f->isOpen()) {
+		for (size_t i = 0; i < run.size(); i++) {
+			f->writeLine(run[i]);
+		}
+
+		if (f->rewind()) return f;
+	}
+
+	delete f;
+	return NULL;
+}
+
+// Head of a spilled run waiting in the merge heap
+struct RunHead {
 	string line;
-	vector<string> lines;
-	ifstream file;
+	size_t run;
+};
+
+// Orders the merge heap by length, then by run index. Runs are cut from the
+// input in order, so breaking ties by run keeps the merge stable.
+struct CompareRunHead {
+	bool operator()(const RunHead& a, const RunHead& b) const {
+		if (a.line.length() != b.line.length()) {
+			return a.line.length() > b.line.length();
+		}
+		return a.run > b.run;
+	}
+};
+
+// Merge runs, given in input order, with a k-way heap and write the lines in
+// order to out. Each run is closed as soon as its last line is taken. Returns
+// false if a run could not be read back.
+template <typename Output>
+bool mergeRuns(vector<RunFile*>& files, Output& out) {
+	priority_queue<RunHead, vector<RunHead>, CompareRunHead> heap;
+	RunHead head;
+	string_view line;
+	bool read = true;
+
+	// Seed the heap with the first line of each run
+	for (size_t r = 0; r < files.size(); r++) {
+		head.run = r;
+		if (files[r]->next(line)) {
+			head.line.assign(line);
+			heap.push(head);
+		} else {
+			read = !files[r]->failed() && read;
+			delete files[r];
+		}
+	}
+
+	// Repeatedly write the shortest head and replace it from the same run
+	while (!heap.empty()) {
+		head = heap.top();
+		heap.pop();
+
+		out.writeLine(head.line);
+
+		if (files[head.run]->next(line)) {
+			head.line.assign(line);
+			heap.push(head);
+		} else {
+			read = !files[head.run]->failed() && read;
+			delete files[head.run];
+		}
+	}
+
+	files.clear();
+	return read;
+}
 
-	// Open file from disk
-	file.open("../../text3.txt");
+// Merge runs into a single new run. Returns NULL if a run could not be read
+// or the new one written.
+RunFile* mergeToRun(vector<RunFile*>& files) {
+	RunFile* merged = new RunFile();
+	if (merged->isOpen() && mergeRuns(files, *merged) && merged->rewind()) return merged;
+
+	delete merged;
+	return NULL;
+}
+
+// Add a spilled run to the runs waiting to be merged. Runs are kept by level:
+// once maxOpenRuns runs pile up on a level they are merged into one run on the
+// level above, so at most maxOpenRuns files per level are open at once. Every
+// run on a level holds lines from earlier in the input than the runs on the
+// levels below it. Returns false if run is NULL, or a merge fails.
+bool addRun(vector<vector<RunFile*>>& levels, RunFile* run) {
+	for (size_t l = 0; run != NULL; l++) {
+		if (l == levels.size()) levels.emplace_back();
+		levels[l].push_back(run);
+
+		if (levels[l].size() < maxOpenRuns) return true;
+		run = mergeToRun(levels[l]);
+	}
+	return false;
+}
+
+// Merge every waiting run and write the lines in order to out. Returns false
+// if a merge fails.
+bool mergeLevels(vector<vector<RunFile*>>& levels, OutputWriter& out) {
+	// Collect the runs in input order, from the top level down
+	vector<RunFile*> files;
+	for (size_t l = levels.size(); l-- > 0; ) {
+		files.insert(files.end(), levels[l].begin(), levels[l].end());
+	}
+
+	// Merge consecutive groups until the rest fit in one merge
+	while (files.size() > maxOpenRuns) {
+		vector<RunFile*> merged;
+
+		for (size_t first = 0; first < files.size(); first += maxOpenRuns) {
+			vector<RunFile*> group(files.begin() + first,
+			                       files.begin() + min(first + maxOpenRuns, files.size()));
+			RunFile* run = mergeToRun(group);
+			if (run == NULL) return false;
+			merged.push_back(run);
+		}
+		files.swap(merged);
+	}
+
+	return mergeRuns(files, out);
+}
+
+// Report a temporary file that could not be created, written or read back
+int runFileFailed() {
+	std::cerr << "Unable to use temporary file" << std::endl;
+	return 1;
+}
+
+int main(int argc, char* argv[]) {
+	// Input path and memory budget (in megabytes) may be given on the
+	// command line
+	const char* path = argc > 1 ? argv[1] : "../../text3.txt";
+	size_t budget = (argc > 2 ? strtoul(argv[2], NULL, 10) : defaultBudgetMB) << 20;
+
+	string_view line;
+
+	// Map the file from disk
+	LineSource file(path);
+
+	// Buffer the output and let a background thread write it, so the merge
+	// does not wait on the output
+	OutputWriter out(STDOUT_FILENO, 1 << 20, true);
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 0;
 	}
 
-	// Read the lines from the file and push each into a vector of strings
-	while (getline(file, line)) {
-		lines.push_back(line);
+	// Each core sorts one run at a time, so split the budget between them
+	size_t threads = max(1u, thread::hardware_concurrency());
+	size_t runBudget = max<size_t>(budget / threads, 1);
+
+	vector<vector<string_view>> runs(1);
+	vector<vector<RunFile*>> spilled;
+	size_t runSize = 0;
+
+	// Read the lines from the file, cutting the input into runs that each fit
+	// in the per-core budget
+	while (file.next(line)) {
+		runSize += lineBytes(line);
+		runs.back().push_back(line);
+
+		if (runSize < runBudget) continue;
+
+		// Once every core has a full run, sort the batch and spill it to disk
+		runSize = 0;
+		if (runs.size() == threads) {
+			sortRuns(runs);
+
+			for (size_t r = 0; r < runs.size(); r++) {
+				if (!addRun(spilled, spillRun(runs[r]))) return runFileFailed();
+			}
+			runs.clear();
+		}
+		runs.emplace_back();
 	}
 
-	// Sort the vector by string length
-	sort(lines.begin(), lines.end(), compareLength);
+	// Sort whatever is left of the input
+	if (runs.back().empty()) runs.pop_back();
+	sortRuns(runs);
+
+	// If the whole input fit in a single run, print it directly
+	if (spilled.empty() && runs.size() <= 1) {
+		for (size_t r = 0; r < runs.size(); r++) {
+			for (size_t i = 0; i < runs[r].size(); i++) {
+				out.writeLine(runs[r][i]);
+			}
+		}
+		return out.finish();
+	}
 
-	// Print the lines, sorted by length, without duplicates
-	for (int i = 0; i < lines.size(); i++) {
-		std::cout << lines[i] << std::endl;
+	// Otherwise spill the remaining runs and merge every run from disk
+	for (size_t r = 0; r < runs.size(); r++) {
+		if (!addRun(spilled, spillRun(runs[r]))) return runFileFailed();
+		vector<string_view>().swap(runs[r]);
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	if (!mergeLevels(spilled, out)) return runFileFailed();
+	return out.finish();
 }
@@ -1,46 +1,117 @@
-#include <algorithm>
-#include <fstream>
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 using namespace std;
 
-int main() {
-	string line;
-	vector<string> lines;
-	ifstream file;
+// Size of the user-space buffer given to each output (1 MB)
+const size_t outputBufferSize = 1 << 20;
 
-	// Open file from disk
-	file.open("../../text.txt");
+// Create a buffered writer for an open file descriptor
+OutputWriter* openOutput(int fd) {
+	if (fd < 0) {
+		std::cerr << "Unable to open output file" << std::endl;
+		exit(1);
+	}
+
+	return new OutputWriter(fd, outputBufferSize);
+}
+
+// Copy a spooled output to another in large blocks
+void copyOutput(int from, OutputWriter& to) {
+	vector<char> buffer(outputBufferSize);
+	ssize_t len;
+
+	lseek(from, 0, SEEK_SET);
+	while ((len = read(from, buffer.data(), buffer.size())) > 0) {
+		to.write(buffer.data(), len);
+	}
+}
+
+// Heading printed before partition p of k on stdout
+string heading(int p, int k) {
+	if (k == 2) return p == 0 ? "|| EVEN LINES ||" : "|| ODD LINES ||";
+	return "|| LINES " + to_string(p) + " MOD " + to_string(k) + " ||";
+}
+
+int main(int argc, char* argv[]) {
+	// Usage: main [file] [k [prefix]]
+	// Line number l (counting from 1) goes to partition l % k, with k = 2 by
+	// default. With a prefix, partition p is written to the file <prefix>.<p>;
+	// without one, the partitions are printed one after another, so by default
+	// the even lines come first and then the odd lines.
+	const char* path = argc > 1 ? argv[1] : "../../text.txt";
+	int k = argc > 2 ? atoi(argv[2]) : 2;
+	const char* prefix = argc > 3 ? argv[3] : NULL;
+
+	string_view line;
+
+	// Map the file from disk
+	LineSource file(path);
 
 	// Check if file is open
-	if (!file.is_open()) {
+	if (!file.isOpen()) {
 		std::cerr << "Unable to open file" << std::endl;
 		return 0;
 	}
 
-	// Read the lines from the file and push each into a vector of strings
-	while (getline(file, line)) {
-		lines.push_back(line);
+	if (k < 1) {
+		std::cerr << "Number of partitions must be positive" << std::endl;
+		return 1;
 	}
 
-	// Print the even lines
-	std::cout << "|| EVEN LINES ||" << std::endl;
-	for (int i = 0; i < lines.size(); i++) {
-		if ((i + 1) % 2 == 0) {
-			std::cout << lines[i] << std::endl;
+	// Create one output per partition. Without a prefix, partition 0 goes
+	// straight to stdout and the others are spooled to temporary files until
+	// the end.
+	vector<OutputWriter*> outputs;
+	vector<FILE*> spools;
+
+	if (prefix != NULL) {
+		for (int p = 0; p < k; p++) {
+			string name = string(prefix) + "." + to_string(p);
+			outputs.push_back(openOutput(open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)));
+		}
+	} else {
+		outputs.push_back(openOutput(STDOUT_FILENO));
+		for (int p = 1; p < k; p++) {
+			FILE* spool = tmpfile();
+			spools.push_back(spool);
+			outputs.push_back(openOutput(spool != NULL ? fileno(spool) : -1));
 		}
+
+		outputs[0]->writeLine(heading(0, k));
 	}
 
-	// Print the odd lines
-	std::cout << "|| ODD LINES ||" << std::endl;
-	for (int i = 0; i < lines.size(); i++) {
-		if ((i + 1) % 2 != 0) {
-			std::cout << lines[i] << std::endl;
-		}
+	// Read the lines from the file and route each to its partition in one pass
+	long lineNumber = 0;
+	while (file.next(line)) {
+		lineNumber++;
+		outputs[lineNumber % k]->writeLine(line);
+	}
+
+	// Print the spooled partitions after partition 0
+	for (int p = 1; p <= (int)spools.size(); p++) {
+		outputs[p]->flush();
+		outputs[0]->writeLine(heading(p, k));
+		copyOutput(fileno(spools[p - 1]), *outputs[0]);
+	}
+
+	// Flush every output, failing if any of them lost output
+	int status = 0;
+	for (size_t p = 0; p < outputs.size(); p++) {
+		int fd = outputs[p]->fd;
+		if (outputs[p]->finish() != 0) status = 1;
+		delete outputs[p];
+
+		if (prefix != NULL) close(fd);
+	}
+	for (size_t p = 0; p < spools.size(); p++) {
+		fclose(spools[p]);
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return status;
 }
@@ -1,44 +1,225 @@
+#include "../../../common/OutputWriter.hpp"
+#include "../../LineSource.hpp"
+#include "../../RunFile.hpp"
 #include <algorithm>
-#include <ctime>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include <random>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 using namespace std;
 
-int main() {
-	string line;
-	vector<string> lines;
-	ifstream file;
+// Default memory budget for lines held in memory (in megabytes)
+const size_t defaultBudgetMB = 256;
 
-	// Open file from disk
-	file.open("../../text3.txt");
+// Pick k random lines with reservoir sampling, using O(k) memory
+void sampleLines(LineSource& file, size_t k, mt19937_64& rng, OutputWriter& out) {
+	vector<string_view> reservoir;
+	string_view line;
+	size_t seen = 0;
 
-	// Check if file is open
-	if (!file.is_open()) {
-		std::cerr << "Unable to open file" << std::endl;
-		return 0;
+	// Keep the first k lines, then replace a random slot with line i with
+	// probability k/i
+	while (file.next(line)) {
+		seen++;
+
+		if (reservoir.size() < k) {
+			reservoir.push_back(line);
+			continue;
+		}
+
+		size_t slot = uniform_int_distribution<size_t>(0, seen - 1)(rng);
+		if (slot < k) reservoir[slot] = line;
 	}
 
+	// The reservoir holds a uniform sample but not in uniform order
+	shuffle(reservoir.begin(), reservoir.end(), rng);
+
+	for (size_t i = 0; i < reservoir.size(); i++) {
+		out.writeLine(reservoir[i]);
+	}
+}
+
+// Shuffle a file in memory, as a single bucket
+void shuffleInMemory(LineSource& file, mt19937_64& rng, OutputWriter& out) {
+	vector<string_view> lines;
+	string_view line;
+
 	// Read the lines from the file and push each into a vector of strings
-	while (getline(file, line)) {
+	while (file.next(line)) {
 		lines.push_back(line);
 	}
 
-	// Create random seed value
-	std::default_random_engine rng(std::chrono::system_clock::now().time_since_epoch().count());
-
 	// Randomize the vector
-	std::shuffle(lines.begin(), lines.end(), rng);
+	shuffle(lines.begin(), lines.end(), rng);
 
 	// Print the randomized lines from the vector
-	for (int i = 0; i < lines.size(); i++) {
-		std::cout << lines[i] << std::endl;
+	for (size_t i = 0; i < lines.size(); i++) {
+		out.writeLine(lines[i]);
+	}
+}
+
+// Load the lines of bucket files into memory and shuffle each with its own
+// seed, one bucket per thread, then print them in order. Each file is closed
+// once loaded. Returns false if a bucket could not be written or read back.
+bool shuffleBuckets(vector<RunFile*>& files, vector<uint64_t>& seeds, OutputWriter& out) {
+	vector<vector<string>> loaded(files.size());
+	vector<char> failed(files.size());
+	vector<thread> workers;
+
+	for (size_t b = 0; b < files.size(); b++) {
+		workers.emplace_back([&files, &loaded, &failed, &seeds, b]() {
+			vector<string>& lines = loaded[b];
+			string_view l;
+			mt19937_64 bucketRng(seeds[b]);
+
+			bool written = files[b]->rewind();
+			while (files[b]->next(l)) {
+				lines.emplace_back(l);
+			}
+			failed[b] = !written || files[b]->failed();
+			delete files[b];
+
+			shuffle(lines.begin(), lines.end(), bucketRng);
+		});
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+
+	files.clear();
+	seeds.clear();
+	if (find(failed.begin(), failed.end(), true) != failed.end()) return false;
+
+	for (size_t g = 0; g < loaded.size(); g++) {
+		for (size_t i = 0; i < loaded[g].size(); i++) {
+			out.writeLine(loaded[g][i]);
+		}
+	}
+	return true;
+}
+
+// Shuffle the lines of a source larger than memory. Every line is scattered
+// to a uniformly random bucket on disk, then each bucket is shuffled in
+// memory. Concatenating the shuffled buckets gives a uniform permutation of
+// the whole source.
+//
+// At most maxOpenRuns buckets are used at once. A bucket that is still too
+// large to load is shuffled the same way in turn, which keeps the result
+// uniform. Returns false if a bucket could not be created, written or read
+// back.
+template <typename Source>
+bool shuffleExternal(Source& source, size_t bytes, size_t bucketBudget, size_t threads,
+                     mt19937_64& rng, OutputWriter& out) {
+	// Lines take about twice their size on disk once loaded into strings
+	size_t buckets = min(2 * bytes / bucketBudget + 1, maxOpenRuns);
+	vector<RunFile*> files(buckets);
+	vector<size_t> sizes(buckets);
+	vector<size_t> counts(buckets);
+	string_view line;
+
+	for (size_t b = 0; b < buckets; b++) {
+		files[b] = new RunFile();
+		if (!files[b]->isOpen()) return false;
+	}
+
+	// Scatter the lines between the buckets
+	uniform_int_distribution<size_t> pickBucket(0, buckets - 1);
+	while (source.next(line)) {
+		size_t b = pickBucket(rng);
+		files[b]->writeLine(line);
+		sizes[b] += line.size() + 1;
+		counts[b]++;
+	}
+
+	// Draw a seed for every bucket up front so the output only depends on the
+	// seed and the bucket sizes
+	vector<uint64_t> seeds(buckets);
+	for (size_t b = 0; b < buckets; b++) {
+		seeds[b] = rng();
+	}
+
+	// Shuffle the buckets in order: up to one per thread at a time in memory,
+	// and any that are still too large one at a time on disk. A bucket of a
+	// single line is loaded whatever its size.
+	vector<RunFile*> group;
+	vector<uint64_t> groupSeeds;
+
+	for (size_t b = 0; b < buckets; b++) {
+		if (2 * sizes[b] > bucketBudget && counts[b] > 1) {
+			if (!shuffleBuckets(group, groupSeeds, out)) return false;
+
+			mt19937_64 bucketRng(seeds[b]);
+			bool shuffled = files[b]->rewind() &&
+			                shuffleExternal(*files[b], sizes[b], bucketBudget, threads, bucketRng, out) &&
+			                !files[b]->failed();
+			delete files[b];
+			if (!shuffled) return false;
+			continue;
+		}
+
+		group.push_back(files[b]);
+		groupSeeds.push_back(seeds[b]);
+		if (group.size() == threads && !shuffleBuckets(group, groupSeeds, out)) return false;
+	}
+
+	return shuffleBuckets(group, groupSeeds, out);
+}
+
+int main(int argc, char* argv[]) {
+	// Usage: main [file] [--seed s] [--sample k] [--budget megabytes]
+	const char* path = "../../text3.txt";
+	uint64_t seed = chrono::system_clock::now().time_since_epoch().count();
+	size_t sample = 0;
+	size_t budget = defaultBudgetMB << 20;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+			sample = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+			budget = max<size_t>(strtoull(argv[++i], NULL, 10) << 20, 1);
+		} else {
+			path = argv[i];
+		}
+	}
+
+	// Map the file from disk
+	LineSource file(path);
+
+	OutputWriter out;
+
+	// Check if file is open
+	if (!file.isOpen()) {
+		std::cerr << "Unable to open file" << std::endl;
+		return 0;
+	}
+
+	// Create the random engine, seeded from the clock unless a seed is given
+	mt19937_64 rng(seed);
+
+	// Size the buckets so every core can hold one in memory at once. Lines
+	// take about twice their size on disk once loaded into strings.
+	size_t bytes = file.length;
+	size_t threads = max(1u, thread::hardware_concurrency());
+	size_t bucketBudget = max<size_t>(budget / threads, 1);
+
+	if (sample > 0) {
+		sampleLines(file, sample, rng, out);
+	} else if (2 * bytes < bucketBudget) {
+		shuffleInMemory(file, rng, out);
+	} else if (!shuffleExternal(file, bytes, bucketBudget, threads, rng, out)) {
+		std::cerr << "Unable to use temporary file" << std::endl;
+		return 1;
 	}
 
-	// Close file
-	file.close();
-	return 0;
+	return out.finish();
 }
@@ -1,45 +1,185 @@
+#include "../LineSource.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
-#include <stack>
-#include <vector> 
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using namespace std;
 
-int main() {
-	// Create an array that will initialize the dyck_word vector 
-	// and an integer to calculate the number of elements using pointers
-	int dyck_sequence[] = { 1, 1, -1, -1 };
-	int n = sizeof(dyck_sequence) / sizeof(dyck_sequence[0]);
-
-	// Create the dyck_word vector
-	vector<int> word(dyck_sequence, dyck_sequence + n);
-
-	// Create a stack to implement the dyck word operations
-	stack<int> word_stack;
-	int dyck_prop = 0;
-
-	// Loop through the dyck_word and perform the corresponding stack operations
-	for (int i = 0; i < word.size(); i++) {
-		if (word[i] == 1) {
-			word_stack.push(dyck_prop);
-		} else if (word[i] == -1){
-			// If the dyck word sequence is about to become negative, print
-			// message and return.
-			// (Otherwise, seg fault would occur due to `pop` operation being
-			// performed on empty stack)
-			if (word_stack.empty()) {
-				std::cout << "Is not a Dyck word" << std::endl;
-				return 1;
-			}
-
-			word_stack.pop();
+// Chunks smaller than this are not worth a thread of their own
+const size_t minChunkSize = 1 << 20;
+
+// A Dyck word only depends on its running sum, so a piece of the sequence is
+// summarized by its total and the lowest value the running sum reaches (the
+// empty prefix counts, so minPrefix <= 0)
+struct DyckSummary {
+	long sum;
+	long minPrefix;
+};
+
+// Summary of piece a followed by piece b
+DyckSummary combine(DyckSummary a, DyckSummary b) {
+	DyckSummary c;
+	c.sum = a.sum + b.sum;
+	c.minPrefix = min(a.minPrefix, a.sum + b.minPrefix);
+	return c;
+}
+
+// Scalar kernel: walk the running sum one symbol at a time
+DyckSummary summarizeScalar(const int8_t* word, size_t n) {
+	DyckSummary s = { 0, 0 };
+
+	for (size_t i = 0; i < n; i++) {
+		s.sum += word[i];
+		s.minPrefix = min(s.minPrefix, s.sum);
+	}
+
+	return s;
+}
+
+#ifdef __SSE2__
+// SSE2 kernel: compute the prefix sums of 16 symbols at once with log-step
+// shifted adds, then fold the block's total and minimum into the running sum.
+// Sums inside a block stay within [-16, 16], so 8-bit lanes cannot overflow.
+DyckSummary summarizeSSE2(const int8_t* word, size_t n) {
+	const __m128i flip = _mm_set1_epi8((char)0x80);
+	DyckSummary s = { 0, 0 };
+	size_t i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i prefix = _mm_loadu_si128((const __m128i*)(word + i));
+		prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 1));
+		prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 2));
+		prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 4));
+		prefix = _mm_add_epi8(prefix, _mm_slli_si128(prefix, 8));
+
+		// SSE2 only has an unsigned byte minimum, so flip the sign bits first
+		__m128i m = _mm_xor_si128(prefix, flip);
+		m = _mm_min_epu8(m, _mm_srli_si128(m, 8));
+		m = _mm_min_epu8(m, _mm_srli_si128(m, 4));
+		m = _mm_min_epu8(m, _mm_srli_si128(m, 2));
+		m = _mm_min_epu8(m, _mm_srli_si128(m, 1));
+
+		long blockMin = (int8_t)(_mm_cvtsi128_si32(m) ^ 0x80);
+		long blockSum = (int8_t)_mm_cvtsi128_si32(_mm_srli_si128(prefix, 15));
+
+		s.minPrefix = min(s.minPrefix, s.sum + blockMin);
+		s.sum += blockSum;
+	}
+
+	return combine(s, summarizeScalar(word + i, n - i));
+}
+#endif
+
+DyckSummary summarizeChunk(const int8_t* word, size_t n) {
+#ifdef __SSE2__
+	return summarizeSSE2(word, n);
+#else
+	return summarizeScalar(word, n);
+#endif
+}
+
+// Offset of the first symbol that is neither +1 nor -1, or n if there is none.
+// The kernels above only hold for +1s and -1s (other values overflow the
+// SSE2 lanes), so input is checked before it is summarized.
+size_t findInvalidSymbol(const int8_t* word, size_t n) {
+	size_t i = 0;
+
+#ifdef __SSE2__
+	const __m128i plus = _mm_set1_epi8(1);
+	const __m128i minus = _mm_set1_epi8(-1);
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(word + i));
+		__m128i valid = _mm_or_si128(_mm_cmpeq_epi8(block, plus), _mm_cmpeq_epi8(block, minus));
+		unsigned mask = _mm_movemask_epi8(valid);
+
+		if (mask != 0xffff) return i + __builtin_ctz(~mask);
+	}
+#endif
+
+	for (; i < n; i++) {
+		if (word[i] != 1 && word[i] != -1) return i;
+	}
+
+	return n;
+}
+
+// Split the sequence into one chunk per core, summarize the chunks in parallel
+// and combine the summaries in order
+DyckSummary summarize(const int8_t* word, size_t n) {
+	size_t threads = max(1u, thread::hardware_concurrency());
+	size_t chunks = min(threads, n / minChunkSize + 1);
+	size_t chunkSize = (n + chunks - 1) / chunks;
+
+	vector<DyckSummary> summaries(chunks);
+	vector<thread> workers;
+
+	for (size_t c = 0; c < chunks; c++) {
+		workers.emplace_back([&summaries, word, n, chunkSize, c]() {
+			size_t start = min(c * chunkSize, n);
+			size_t end = min(start + chunkSize, n);
+			summaries[c] = summarizeChunk(word + start, end - start);
+		});
+	}
+
+	DyckSummary s = { 0, 0 };
+	for (size_t c = 0; c < chunks; c++) {
+		workers[c].join();
+		s = combine(s, summaries[c]);
+	}
+
+	return s;
+}
+
+// A sequence of +1s and -1s is a Dyck word if its running sum never drops
+// below zero and it ends at zero
+bool isDyckWord(const int8_t* word, size_t n) {
+	DyckSummary s = summarize(word, n);
+	return s.minPrefix >= 0 && s.sum == 0;
+}
+
+// Exit status for input with a byte other than +1 or -1
+const int invalidInputStatus = 2;
+
+int main(int argc, char* argv[]) {
+	// The sequence may be given as a file of packed signed bytes, each +1 (0x01)
+	// or -1 (0xff). Otherwise a small example sequence is checked. Exits with 0
+	// for a Dyck word, 1 otherwise, and 2 if the file holds any other byte.
+	int8_t dyck_sequence[] = { 1, 1, -1, -1 };
+	const int8_t* word = dyck_sequence;
+	size_t n = sizeof(dyck_sequence) / sizeof(dyck_sequence[0]);
+
+	LineSource file(argc > 1 ? argv[1] : "");
+
+	if (argc > 1) {
+		// Check if file is open
+		if (!file.isOpen()) {
+			std::cerr << "Unable to open file" << std::endl;
+			return 1;
+		}
+
+		word = (const int8_t*)file.data;
+		n = file.length;
+
+		size_t bad = findInvalidSymbol(word, n);
+		if (bad < n) {
+			std::cerr << "Invalid symbol " << (int)word[bad] << " at offset " << bad
+			          << " (expected +1 or -1)" << std::endl;
+			return invalidInputStatus;
 		}
 	}
 
 	// Print to console result of dyck word operations
-	if (word_stack.empty()) {
+	if (isDyckWord(word, n)) {
 		std::cout << "Is a Dyck word" << std::endl;
-	} else {
-		std::cout << "Is not a Dyck word" << std::endl;
+		return 0;
 	}
 
-	return 0;
+	std::cout << "Is not a Dyck word" << std::endl;
+	return 1;
 }
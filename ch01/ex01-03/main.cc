@@ -1,56 +1,199 @@
+#include "../LineSource.hpp"
 #include <algorithm>
 #include <iostream>
-#include <stack>
 #include <string>
-#include <vector> 
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 using namespace std;
 
-bool isMatchedString(string str) {
-	// Create vectors of opening and closing brackets
-	vector<char> opening_chars = { '{', '(', '[' };
-	vector<char> closing_chars = { '}', ')', ']' };
-
-	// Create a stack to implement the matched string operations
-	stack<char> matched_stack;
-
-	// Loop through the sequence of chars and check whether each is an opening
-	// or closing bracket
-	for (int i = 0; i < sizeof(str) / sizeof(char); i++) {
-		if (find(opening_chars.begin(), opening_chars.end(), str[i]) != opening_chars.end()) {
-			// Push the opening bracket onto the stack
-			matched_stack.push(str[i]);
-		} else if (find(closing_chars.begin(), closing_chars.end(), str[i]) != closing_chars.end()) {
-			// If first bracket is a closing bracket, return false
-			if (matched_stack.empty()) return false;
-
-			// Create an interator over the vector of closing chars to get
-			// its index in the vector
-			auto it = find(closing_chars.begin(), closing_chars.end(), str[i]);
-			int index = distance(closing_chars.begin(), it);
-
-			// If the top char on the stack matches the closing brace, pop it
-			// off the stack
-			// Otherwise, break out of the loop
-			if (opening_chars[index] == matched_stack.top()) {
-				matched_stack.pop();
-			} else {
-				break;
+// Returned by firstMismatch() when every bracket is matched
+const size_t matched = (size_t)-1;
+
+// Chunks smaller than this are not worth a thread of their own
+const size_t minChunkSize = 1 << 20;
+
+// Return the opening bracket for a closing bracket, or 0 for an opening one
+char openerOf(char c) {
+	switch (c) {
+	case ')': return '(';
+	case ']': return '[';
+	case '}': return '{';
+	default: return 0;
+	}
+}
+
+// A run of closing brackets at consecutive offsets, such as "))]"
+struct CloserRun {
+	size_t offset;
+	size_t length;
+};
+
+// What a chunk leaves for its neighbours once the brackets inside it have
+// been matched with each other
+struct ChunkSummary {
+	// Byte stack of closing brackets that ran out of openers, which must
+	// match openers left open by earlier chunks. Their offsets are kept as
+	// runs, so a stretch like ")))}" costs one entry rather than one each.
+	string unmatchedClosers;
+	vector<CloserRun> closerRuns;
+
+	// Byte stack of opening brackets still open at the end of the chunk
+	string unmatchedOpeners;
+
+	// Offset of a closing bracket that met the wrong opener, or matched
+	size_t error;
+};
+
+// Record a closing bracket that ran out of openers
+void addUnmatchedCloser(ChunkSummary& s, char c, size_t offset) {
+	s.unmatchedClosers.push_back(c);
+
+	if (!s.closerRuns.empty()) {
+		CloserRun& last = s.closerRuns.back();
+		if (last.offset + last.length == offset) {
+			last.length++;
+			return;
+		}
+	}
+	s.closerRuns.push_back(CloserRun { offset, 1 });
+}
+
+// Match one bracket against the chunk's stack. Returns false on a mismatch.
+bool matchBracket(ChunkSummary& s, char c, size_t offset) {
+	char opener = openerOf(c);
+
+	if (opener == 0) {
+		s.unmatchedOpeners.push_back(c);
+	} else if (s.unmatchedOpeners.empty()) {
+		addUnmatchedCloser(s, c, offset);
+	} else if (s.unmatchedOpeners.back() == opener) {
+		s.unmatchedOpeners.pop_back();
+	} else {
+		s.error = offset;
+		return false;
+	}
+
+	return true;
+}
+
+// Match the brackets in [begin, end). Blocks of 16 bytes are classified at
+// once, so text without brackets is skipped without looking at each byte.
+ChunkSummary scanChunk(const char* str, size_t begin, size_t end) {
+	ChunkSummary s;
+	s.error = matched;
+	size_t i = begin;
+
+#ifdef __SSE2__
+	const char brackets[] = { '(', ')', '[', ']', '{', '}' };
+
+	for (; i + 16 <= end; i += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+		__m128i found = _mm_setzero_si128();
+
+		for (int b = 0; b < 6; b++) {
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(block, _mm_set1_epi8(brackets[b])));
+		}
+
+		// Visit each bracket in the block, lowest offset first
+		for (unsigned mask = _mm_movemask_epi8(found); mask != 0; mask &= mask - 1) {
+			size_t offset = i + __builtin_ctz(mask);
+			if (!matchBracket(s, str[offset], offset)) return s;
+		}
+	}
+#endif
+
+	for (; i < end; i++) {
+		char c = str[i];
+		bool isBracket = c == '(' || c == ')' || c == '[' || c == ']' || c == '{' || c == '}';
+
+		if (isBracket && !matchBracket(s, c, i)) return s;
+	}
+
+	return s;
+}
+
+// Return the offset of the first bracket that cannot be matched, the length
+// of the string if some brackets are never closed, or `matched`. The string is
+// scanned in parallel chunks whose summaries are then stitched together.
+size_t firstMismatch(const char* str, size_t n) {
+	size_t threads = max(1u, thread::hardware_concurrency());
+	size_t chunks = min(threads, n / minChunkSize + 1);
+	size_t chunkSize = (n + chunks - 1) / chunks;
+
+	vector<ChunkSummary> summaries(chunks);
+	vector<thread> workers;
+
+	for (size_t c = 0; c < chunks; c++) {
+		workers.emplace_back([&summaries, str, n, chunkSize, c]() {
+			size_t begin = min(c * chunkSize, n);
+			summaries[c] = scanChunk(str, begin, min(begin + chunkSize, n));
+		});
+	}
+
+	for (size_t t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+
+	// Stitch the chunks together in order on one stack of open brackets
+	string open;
+
+	for (size_t c = 0; c < chunks; c++) {
+		ChunkSummary& s = summaries[c];
+
+		// Closers that ran out of openers in their chunk close earlier chunks
+		size_t k = 0;
+		for (size_t r = 0; r < s.closerRuns.size(); r++) {
+			for (size_t j = 0; j < s.closerRuns[r].length; j++, k++) {
+				if (open.empty() || open.back() != openerOf(s.unmatchedClosers[k])) {
+					return s.closerRuns[r].offset + j;
+				}
+				open.pop_back();
 			}
 		}
+
+		if (s.error != matched) return s.error;
+
+		open += s.unmatchedOpeners;
 	}
 
-	return matched_stack.empty();
+	return open.empty() ? matched : n;
 }
 
-int main() {
+bool isMatchedString(const string& str) {
+	return firstMismatch(str.data(), str.size()) == matched;
+}
+
+int main(int argc, char* argv[]) {
+	// The string may be read from a file. Otherwise a small example is checked.
 	string str = "{{()[]}}";
+	const char* text = str.data();
+	size_t n = str.size();
+
+	LineSource file(argc > 1 ? argv[1] : "");
+
+	if (argc > 1) {
+		// Check if file is open
+		if (!file.isOpen()) {
+			std::cerr << "Unable to open file" << std::endl;
+			return 1;
+		}
+
+		text = file.data;
+		n = file.length;
+	}
+
+	size_t offset = firstMismatch(text, n);
 
 	// Print to console the result of the operations
-	if (isMatchedString(str)) {
+	if (offset == matched) {
 		std::cout << "Matched string" << std::endl;
-	} else {
-		std::cerr << "Not a matched string" << std::endl;
+		return 0;
 	}
 
-	return 0;
+	std::cerr << "Not a matched string (first mismatch at offset " << offset << ")" << std::endl;
+	return 1;
 }
@@ -0,0 +1,69 @@
+#include "../../common/OutputWriter.hpp"
+#include "../LineSource.hpp"
+#include "../Pipeline.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Build a stage from its command line description
+Stage* parseStage(const string& spec) {
+	string name = spec.substr(0, spec.find(':'));
+	string arg = spec.find(':') == string::npos ? "" : spec.substr(spec.find(':') + 1);
+
+	if (name == "reverse") {
+		return new ReverseWindowStage(arg.empty() ? 50 : strtoul(arg.c_str(), NULL, 10));
+	} else if (name == "dedup") {
+		return new DedupStage();
+	} else if (name == "filter") {
+		return new FilterStage(arg);
+	} else if (name == "partition") {
+		long k = strtol(arg.c_str(), NULL, 10);
+		long part = arg.find(':') == string::npos ? 0 : strtol(arg.c_str() + arg.find(':') + 1, NULL, 10);
+		if (k > 0) return new PartitionStage(k, part);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char* argv[]) {
+	// Usage: main file [stage ...]
+	// Stages run in the order given:
+	//   reverse[:n]      reverse each block of n lines (default 50)
+	//   dedup            drop lines that were already seen
+	//   filter[:text]    keep lines containing text (default: non-empty lines)
+	//   partition:k[:r]  keep line number l when l % k == r (default r = 0)
+	if (argc < 2) {
+		std::cerr << "Usage: main file [reverse[:n]|dedup|filter[:text]|partition:k[:r] ...]" << std::endl;
+		return 1;
+	}
+
+	// Map the file from disk
+	LineSource file(argv[1]);
+
+	// Check if file is open
+	if (!file.isOpen()) {
+		std::cerr << "Unable to open file" << std::endl;
+		return 1;
+	}
+
+	// Chain the stages
+	Pipeline pipeline;
+	for (int i = 2; i < argc; i++) {
+		Stage* stage = parseStage(argv[i]);
+
+		if (stage == NULL) {
+			std::cerr << "Unknown stage: " << argv[i] << std::endl;
+			return 1;
+		}
+		pipeline.add(stage);
+	}
+
+	// Run every stage on its own thread, then report their throughput
+	OutputWriter out;
+	pipeline.run(file, out);
+	pipeline.printStats();
+
+	return out.finish();
+}
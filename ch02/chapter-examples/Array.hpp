@@ -1,9 +1,13 @@
 #ifndef ARRAY_HPP
 #define ARRAY_HPP
 
+#include "ArrayAllocators.hpp"
 #include <cassert>
+#include <cstddef>
 
-template <typename T>
+// A fixed-length array. Alloc decides where the elements are allocated (see
+// ArrayAllocators.hpp).
+template <typename T, typename Alloc = NewAllocator>
 class Array {
 public:
 	T *a;
@@ -15,7 +19,7 @@ public:
 		length = len;
 
 		// Set a as new array of size length
-		a = new T[length];
+		a = Alloc::template allocate<T>(length);
 	}
 
 	// Indexing - override [] operator
@@ -27,9 +31,9 @@ public:
 	}
 
 	// Assignment - override = operator
-	Array<T>& operator=(Array<T> &b) {
+	Array<T, Alloc>& operator=(Array<T, Alloc> &b) {
 		// If a is not NULL, free the exiting memory for a
-		if (a != NULL) delete[] a;
+		if (a != NULL) Alloc::deallocate(a, length);
 
 		// Copy the pointer from the source array
 		a = b.a;
@@ -44,6 +48,12 @@ public:
 		// assignments)
 		return *this;
 	}
+
+	// Free the elements of an array that was not handed to another one
+	void release() {
+		if (a != NULL) Alloc::deallocate(a, length);
+		a = NULL;
+	}
 };
 
 #endif // ARRAY_HPP
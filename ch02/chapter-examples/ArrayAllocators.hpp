@@ -0,0 +1,122 @@
+#ifndef ARRAY_ALLOCATORS_HPP
+#define ARRAY_ALLOCATORS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <sys/mman.h>
+
+// Where an Array gets its elements from. An allocator is a class with
+//
+//     template <typename T> static T* allocate(int n);
+//     template <typename T> static void deallocate(T* p, int n);
+//
+// and is picked per container as a template argument, e.g.
+// ArrayStack<long, HugePageAllocator>.
+
+// new T[n], what Array has always used
+class NewAllocator {
+public:
+	template <typename T>
+	static T* allocate(int n) {
+		return new T[n];
+	}
+
+	template <typename T>
+	static void deallocate(T* p, int) {
+		delete[] p;
+	}
+};
+
+// Elements starting on an Align-byte boundary: 64 for a cache line, so a
+// vector load never straddles two lines; 4096 for a page; 2 MiB for a huge
+// page
+template <size_t Align>
+class AlignedAllocator {
+public:
+	static_assert(Align > 0 && (Align & (Align - 1)) == 0, "alignment must be a power of two");
+
+	template <typename T>
+	static T* allocate(int n) {
+		T* p = (T*)::operator new(n * sizeof(T), std::align_val_t(alignment<T>()));
+		std::uninitialized_default_construct_n(p, n);
+		return p;
+	}
+
+	template <typename T>
+	static void deallocate(T* p, int n) {
+		std::destroy_n(p, n);
+		::operator delete(p, std::align_val_t(alignment<T>()));
+	}
+
+	template <typename T>
+	static constexpr size_t alignment() {
+		return Align > alignof(T) ? Align : alignof(T);
+	}
+};
+
+typedef AlignedAllocator<64> CacheLineAllocator;
+typedef AlignedAllocator<4096> PageAllocator;
+
+// Arrays of 2 MiB and more are mapped on 2 MiB pages, so one TLB entry
+// covers 512 times as much of the array as with 4 KiB pages. Reserved huge
+// pages (MAP_HUGETLB) are used when the system has any free. Otherwise the
+// array is mapped on a 2 MiB boundary and the kernel is asked to back it
+// with transparent huge pages (MADV_HUGEPAGE), which it does when it can;
+// when it cannot, the array simply lives on normal pages. Smaller arrays
+// are cache-line aligned.
+class HugePageAllocator {
+public:
+	static const size_t hugePage = 2 << 20;
+
+	template <typename T>
+	static T* allocate(int n) {
+		size_t bytes = n * sizeof(T);
+		if (bytes < hugePage) return CacheLineAllocator::allocate<T>(n);
+
+		T* p = (T*)map(roundUp(bytes));
+		std::uninitialized_default_construct_n(p, n);
+		return p;
+	}
+
+	template <typename T>
+	static void deallocate(T* p, int n) {
+		size_t bytes = n * sizeof(T);
+		if (bytes < hugePage) {
+			CacheLineAllocator::deallocate(p, n);
+			return;
+		}
+
+		std::destroy_n(p, n);
+		munmap(p, roundUp(bytes));
+	}
+
+	static size_t roundUp(size_t bytes) {
+		return (bytes + hugePage - 1) & ~(hugePage - 1);
+	}
+
+	// Map bytes (a multiple of hugePage) on a hugePage boundary
+	static void* map(size_t bytes) {
+#ifdef MAP_HUGETLB
+		void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) return p;
+#endif
+
+		// Map one huge page too many, then unmap the ends that stick out
+		// past the boundaries
+		char* q = (char*)mmap(NULL, bytes + hugePage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (q == MAP_FAILED) throw std::bad_alloc();
+
+		char* start = (char*)(((uintptr_t)q + hugePage - 1) & ~(uintptr_t)(hugePage - 1));
+		if (start > q) munmap(q, start - q);
+		if (q + hugePage > start) munmap(start + bytes, q + hugePage - start);
+
+#ifdef MADV_HUGEPAGE
+		madvise(start, bytes, MADV_HUGEPAGE);
+#endif
+		return start;
+	}
+};
+
+#endif // ARRAY_ALLOCATORS_HPP
@@ -1,18 +1,29 @@
 #ifndef ARRAY_DEQUE_HPP
 #define ARRAY_DEQUE_HPP
 
+#include "../../common/OutputWriter.hpp"
 #include "Array.hpp"
+#include "ArrayKernels.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <type_traits>
 
-// Implements the List interface with a ciruclar array using modular arithmetic
-template <typename T>
+// Implements the List interface with a ciruclar array using modular arithmetic.
+// Alloc allocates the array (see ArrayAllocators.hpp).
+template <typename T, typename Alloc = NewAllocator>
 class ArrayDeque {
 public:
-	Array<T> a;
+	Array<T, Alloc> a;
 	int j;
 	int n;
 
-	ArrayDeque() : a(n = 0) {}
+	// When set, index i refers to element n-1-i, so the deque is reversed
+	// without moving anything
+	bool reversed;
+
+	ArrayDeque() : a(n = 0), j(0), reversed(false) {}
 
 	// === BASICS ===
 
@@ -21,11 +32,15 @@ public:
 	}
 
 	T get(int i) {
+		if (reversed) i = n - 1 - i;
+
 		// Return the value at index i
 		return a[(j+i)%a.length];
 	}
 
 	T set(int i, T x) {
+		if (reversed) i = n - 1 - i;
+
 		// Store the value of index i
 		T y = a[(j+i)%a.length];
 
@@ -35,12 +50,16 @@ public:
 	}
 
 	void add(int i, T x) {
+		// Adding before element i of the reversed deque adds after element
+		// n-1-i of the underlying one
+		if (reversed) i = n - i;
+
 		// Check if a is already full. If so, resize so that a.length > n
 		if (n + 1 > a.length) resize();
 
 		// If i is less than n/2, shift elements 0 ... i-1 to the left
 		if (i < n/2) {
-			j = (j = 0) ? a.length - 1 : j - 1;
+			j = (j == 0) ? a.length - 1 : j - 1;
 
 			for (int k = 0; k <= i - 1; k++) {
 				a[(j+k)%a.length] = a[(j+k+1)%a.length];
@@ -58,6 +77,8 @@ public:
 	}
 
 	T remove(int i) {
+		if (reversed) i = n - 1 - i;
+
 		// Store a[j] so it can be returned later
 		T x = a[(j+i)%a.length];
 
@@ -82,11 +103,102 @@ public:
 		return x;
 	}
 
+	// Reverse the deque in O(1) by swapping the meaning of front and back.
+	// Adding and removing stay cheap at both ends, so nothing has to move.
+	void reverse() {
+		reversed = !reversed;
+	}
+
+	// === BULK OPERATIONS ===
+
+	// Searches and reductions for arithmetic T, a block of elements at a time
+	// (see ArrayKernels.hpp). The circular array holds the elements in two
+	// contiguous pieces, a[j..] and then the wrapped part at the start of a,
+	// and each kernel runs over both.
+
+	// Length of the first piece; the second holds the other n - first
+	int firstSegment() {
+		return std::min(n, a.length - j);
+	}
+
+	// Index of the first element equal to x, or -1
+	int indexOf(T x) {
+		int first = firstSegment();
+		long k;
+
+		if (!reversed) {
+			k = ArrayKernels<T>::indexOf(a.a + j, first, x);
+
+			if (k < 0) {
+				k = ArrayKernels<T>::indexOf(a.a, n - first, x);
+				if (k >= 0) k += first;
+			}
+			return k;
+		}
+
+		// Reversed, the first element is the last one stored
+		k = ArrayKernels<T>::lastIndexOf(a.a, n - first, x);
+
+		if (k >= 0) k += first;
+		else k = ArrayKernels<T>::lastIndexOf(a.a + j, first, x);
+
+		return k < 0 ? -1 : n - 1 - k;
+	}
+
+	bool contains(T x) {
+		return indexOf(x) >= 0;
+	}
+
+	int count(T x) {
+		int first = firstSegment();
+		return ArrayKernels<T>::count(a.a + j, first, x) + ArrayKernels<T>::count(a.a, n - first, x);
+	}
+
+	// The deque must not be empty
+	T min() {
+		int first = firstSegment();
+		if (first == n) return ArrayKernels<T>::min(a.a + j, n);
+
+		T low = ArrayKernels<T>::min(a.a, n - first);
+		return first == 0 ? low : std::min(low, ArrayKernels<T>::min(a.a + j, first));
+	}
+
+	T max() {
+		int first = firstSegment();
+		if (first == n) return ArrayKernels<T>::max(a.a + j, n);
+
+		T high = ArrayKernels<T>::max(a.a, n - first);
+		return first == 0 ? high : std::max(high, ArrayKernels<T>::max(a.a + j, first));
+	}
+
+	T sum() {
+		int first = firstSegment();
+		return ArrayKernels<T>::sum(a.a + j, first) + ArrayKernels<T>::sum(a.a, n - first);
+	}
+
+	// Add the elements for which pred holds to the back of out, in deque
+	// order, and return how many
+	template <typename Pred>
+	int filter(Pred pred, ArrayDeque<T, Alloc>& out) {
+		int first = firstSegment();
+		Array<T, Alloc> matches(n);
+
+		int k = ArrayKernels<T>::filter(a.a + j, first, matches.a, pred);
+		k += ArrayKernels<T>::filter(a.a, n - first, matches.a + k, pred);
+
+		for (int m = 0; m < k; m++) {
+			out.add(out.size(), matches[reversed ? k - 1 - m : m]);
+		}
+
+		matches.release();
+		return k;
+	}
+
 	// === GROWING / SHRINKING ===
 
 	void resize() {
 		// Create a new array that is double the size of the backing array
-		Array<T> b(std::max(2 * n, 1));
+		Array<T, Alloc> b(std::max(2 * n, 1));
 
 		// Copy n elements from a to b
 		for (int k = 0; k < n; k++) {
@@ -100,6 +212,46 @@ public:
 		j = 0;
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp). The circular
+	// array is written as its two contiguous pieces; a reversed deque is saved
+	// as it is stored and flagged as reversed.
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		int first = std::min(n, a.length - j);
+		w.write(a.a + j, first * sizeof(T));
+		w.write(a.a, (n - first) * sizeof(T));
+		return w.finish(n, 0, reversed ? snapshotReversed : 0);
+	}
+
+	// Replace the elements with those of a snapshot, read straight into a new
+	// backing array
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		int m = r.header.count;
+		Array<T, Alloc> b(std::max(2*m, 1));
+
+		if (!r.read(b.a, m * sizeof(T)) || !r.finish()) {
+			b.release();
+			return false;
+		}
+
+		a = b;
+		j = 0;
+		n = m;
+		reversed = (r.header.flags & snapshotReversed) != 0;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -137,20 +289,39 @@ public:
 		std::cout << "ArrayDeque.set(index: 1, value: 4)" << std::endl;
 
 		this->printAllElements();
+		this->reverse();
+		std::cout << "ArrayDeque.reverse()" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "ArrayDeque.indexOf(value: 4) = " << this->indexOf(4) << ", ArrayDeque.sum() = "
+		          << this->sum() << ", ArrayDeque.max() = " << this->max() << std::endl;
+
+		// Save the reversed deque to a snapshot, load it into another deque
+		// and map it, which both read it back in list order
+		char path[] = "/tmp/ArrayDequeXXXXXX";
+		int fd = mkstemp(path);
+		if (fd < 0) return;
+		close(fd);
+
+		bool saved = this->save(path);
+		ArrayDeque<T, Alloc> loaded;
+		bool ok = loaded.load(path);
+		std::cout << "ArrayDeque.save(path) = " << saved << ", load(path) = " << ok
+		          << ", reversed = " << loaded.reversed << std::endl;
+
+		loaded.printAllElements();
+
+		SnapshotView<T> view(path);
+		std::cout << "SnapshotView(path).isOpen() = " << view.isOpen() << std::endl;
+
+		printElements(view.size(), [&view](OutputWriter& out, long i) { out << view.get(i); });
+
+		unlink(path);
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
@@ -0,0 +1,388 @@
+#ifndef ARRAY_KERNELS_HPP
+#define ARRAY_KERNELS_HPP
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_KERNELS_X86
+#endif
+
+// Search and reduction kernels over a plain array of arithmetic elements,
+// used by the bulk operations of the array-based containers.
+//
+// Each kernel is written once on GCC vector types of Bytes bytes, so a block
+// of Bytes/sizeof(T) elements is compared, added or tested at once. It is
+// then compiled three times: for AVX-512 (64 bytes), for AVX2 (32 bytes) and
+// for the baseline (16 bytes, SSE2 on x86-64), and the widest one the CPU
+// supports is picked at runtime.
+//
+// Blocks are summed in a different order than a scalar loop would, so a
+// float sum may round differently. Integer sums wrap around on overflow.
+
+// True for the element types the kernels work on. GCC has no vectors of long
+// double.
+template <typename T>
+constexpr bool hasArrayKernels = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value &&
+                                 !std::is_same<T, long double>::value;
+
+template <typename T>
+class ArrayKernels {
+public:
+	static_assert(hasArrayKernels<T>, "kernels need an arithmetic element type other than long double");
+
+	// Vectors of Bytes bytes. V is only as aligned as T, so *(const V*)p loads
+	// a block from any element address. Vectors never cross a function call
+	// by value: a function compiled without AVX would pass them differently.
+	template <int Bytes>
+	struct Simd {
+		typedef T V __attribute__((vector_size(Bytes), aligned(sizeof(T))));
+		typedef decltype(V() == V()) Mask;
+
+		static const int lanes = Bytes / sizeof(T);
+
+		// True if any lane of the mask is set. The mask is copied out as
+		// 64-bit words and they are or-ed together; GCC keeps the copy in
+		// registers.
+		__attribute__((always_inline)) static bool any(const Mask& m) {
+			uint64_t w[Bytes / 8];
+			memcpy(w, &m, sizeof(w));
+
+			uint64_t r = 0;
+			for (int k = 0; k < Bytes / 8; k++) {
+				r |= w[k];
+			}
+			return r != 0;
+		}
+	};
+
+	// === KERNELS ===
+
+	// Index of the first element equal to x, or -1. Four blocks are compared
+	// between branches; the block holding the match is then scanned. The four
+	// masks (lanes of 0 or -1) are added rather than or-ed: GCC 12 turns an or
+	// of AVX-512 compare masks into scalar code.
+	struct IndexOf {
+		template <int Bytes>
+		__attribute__((always_inline)) static long run(const T* p, long n, T x) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			const V vx = V() + x;
+			long i = 0;
+
+			for (; i + 4*S::lanes <= n; i += 4*S::lanes) {
+				typename S::Mask m = (*(const V*)(p + i) == vx) + (*(const V*)(p + i + S::lanes) == vx) +
+				                     (*(const V*)(p + i + 2*S::lanes) == vx) +
+				                     (*(const V*)(p + i + 3*S::lanes) == vx);
+				if (S::any(m)) break;
+			}
+
+			for (; i < n; i++) {
+				if (p[i] == x) return i;
+			}
+			return -1;
+		}
+	};
+
+	// Index of the last element equal to x, or -1
+	struct LastIndexOf {
+		template <int Bytes>
+		__attribute__((always_inline)) static long run(const T* p, long n, T x) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			const V vx = V() + x;
+			long i = n;
+
+			for (; i >= 4*S::lanes; i -= 4*S::lanes) {
+				const T* q = p + i - 4*S::lanes;
+				typename S::Mask m = (*(const V*)q == vx) + (*(const V*)(q + S::lanes) == vx) +
+				                     (*(const V*)(q + 2*S::lanes) == vx) +
+				                     (*(const V*)(q + 3*S::lanes) == vx);
+				if (S::any(m)) break;
+			}
+
+			for (i--; i >= 0; i--) {
+				if (p[i] == x) return i;
+			}
+			return -1;
+		}
+	};
+
+	// Number of elements equal to x. Matching lanes are -1, so subtracting
+	// masks counts them; the lane counters are emptied before they overflow.
+	struct Count {
+		template <int Bytes>
+		__attribute__((always_inline)) static long run(const T* p, long n, T x) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			const V vx = V() + x;
+			long total = 0;
+			long i = 0;
+
+			while (i + S::lanes <= n) {
+				typename S::Mask counts = typename S::Mask();
+
+				for (int b = 0; b < 127 && i + S::lanes <= n; b++, i += S::lanes) {
+					counts -= *(const V*)(p + i) == vx;
+				}
+
+				for (int l = 0; l < S::lanes; l++) {
+					total += counts[l];
+				}
+			}
+
+			for (; i < n; i++) {
+				total += p[i] == x;
+			}
+			return total;
+		}
+	};
+
+	struct Sum {
+		template <int Bytes>
+		__attribute__((always_inline)) static T run(const T* p, long n) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			V acc0 = V();
+			V acc1 = V();
+			long blocks = n - n % (2*S::lanes);
+			long i = 0;
+
+			// Two accumulators keep two additions in flight
+			for (; i < blocks; i += 2*S::lanes) {
+				acc0 += *(const V*)(p + i);
+				acc1 += *(const V*)(p + i + S::lanes);
+			}
+			acc0 += acc1;
+
+			T total = 0;
+			for (int l = 0; l < S::lanes; l++) {
+				total += acc0[l];
+			}
+			for (; i < n; i++) {
+				total += p[i];
+			}
+			return total;
+		}
+	};
+
+	// Smallest element (largest if Largest); n must be positive
+	template <bool Largest>
+	struct Extreme {
+		template <int Bytes>
+		__attribute__((always_inline)) static T run(const T* p, long n) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			T best = p[0];
+			long blocks = n - n % S::lanes;
+			long i = 0;
+
+			if (blocks > 0) {
+				V acc = *(const V*)p;
+
+				for (i = S::lanes; i < blocks; i += S::lanes) {
+					V v = *(const V*)(p + i);
+					acc = Largest ? (v > acc ? v : acc) : (v < acc ? v : acc);
+				}
+
+				for (int l = 0; l < S::lanes; l++) {
+					best = Largest ? (acc[l] > best ? acc[l] : best) : (acc[l] < best ? acc[l] : best);
+				}
+			}
+
+			for (; i < n; i++) {
+				best = Largest ? (p[i] > best ? p[i] : best) : (p[i] < best ? p[i] : best);
+			}
+			return best;
+		}
+	};
+
+	// Reverse the elements in place. A block is loaded from each end, its
+	// lanes are put in reverse order with one shuffle, and it is stored at
+	// the other end. GCC does not vectorize std::reverse, which swaps one
+	// pair of elements at a time.
+	struct Reverse {
+		template <int Bytes>
+		__attribute__((always_inline)) static void run(T* p, long n) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+
+			typename S::Mask lanes;
+			for (int l = 0; l < S::lanes; l++) {
+				lanes[l] = S::lanes - 1 - l;
+			}
+
+			long i = 0;
+			long j = n - S::lanes;
+			for (; i + S::lanes <= j; i += S::lanes, j -= S::lanes) {
+				V front = *(V*)(p + i);
+				V back = *(V*)(p + j);
+				*(V*)(p + i) = __builtin_shuffle(back, lanes);
+				*(V*)(p + j) = __builtin_shuffle(front, lanes);
+			}
+
+			// Fewer than two blocks are left in the middle
+			for (j += S::lanes - 1; i < j; i++, j--) {
+				T x = p[i];
+				p[i] = p[j];
+				p[j] = x;
+			}
+		}
+	};
+
+	// Copy the elements for which pred holds into out, in order, and return
+	// how many there were. pred is called on whole blocks and returns a mask
+	// (see PREDICATES); blocks without a match are skipped.
+	struct Filter {
+		template <int Bytes, typename Pred>
+		__attribute__((always_inline)) static long run(const T* p, long n, T* out, Pred pred) {
+			typedef Simd<Bytes> S;
+			typedef typename S::V V;
+			long k = 0;
+
+			for (long i = 0; i < n; i += S::lanes) {
+				int len = n - i < S::lanes ? n - i : S::lanes;
+
+				// The last, partial block is padded through a copy
+				V v = V();
+				if (len == S::lanes) v = *(const V*)(p + i);
+				else memcpy(&v, p + i, len * sizeof(T));
+
+				typename S::Mask m;
+				pred(v, m);
+				if (!S::any(m)) continue;
+
+				for (int l = 0; l < len; l++) {
+					if (m[l]) out[k++] = v[l];
+				}
+			}
+			return k;
+		}
+	};
+
+	// === PREDICATES ===
+
+	// Ready-made predicates for filter(). A predicate sets each lane of the
+	// mask m from the same lane of the block v; any callable of that form
+	// works. Both are passed by reference, since a vector passed by value to
+	// a function compiled without AVX would use a different calling
+	// convention.
+	struct Less {
+		T x;
+		Less(T x0) : x(x0) {}
+
+		template <typename V, typename Mask>
+		__attribute__((always_inline)) void operator()(const V& v, Mask& m) const {
+			m = v < x;
+		}
+	};
+
+	struct Greater {
+		T x;
+		Greater(T x0) : x(x0) {}
+
+		template <typename V, typename Mask>
+		__attribute__((always_inline)) void operator()(const V& v, Mask& m) const {
+			m = v > x;
+		}
+	};
+
+	// lo <= element <= hi
+	struct Between {
+		T lo;
+		T hi;
+		Between(T lo0, T hi0) : lo(lo0), hi(hi0) {}
+
+		template <typename V, typename Mask>
+		__attribute__((always_inline)) void operator()(const V& v, Mask& m) const {
+			// Both hold where the two masks add up to -2 (see IndexOf for
+			// why they are not and-ed)
+			m = (v >= lo) + (v <= hi) == -2;
+		}
+	};
+
+	// === DISPATCH ===
+
+#ifdef ARRAY_KERNELS_X86
+	template <typename Kernel, typename R, typename... Args>
+	__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+	static R runAVX512(Args... args) {
+		return Kernel::template run<64>(args...);
+	}
+
+	template <typename Kernel, typename R, typename... Args>
+	__attribute__((target("avx2")))
+	static R runAVX2(Args... args) {
+		return Kernel::template run<32>(args...);
+	}
+#endif
+
+	template <typename Kernel, typename R, typename... Args>
+	static R runBaseline(Args... args) {
+		return Kernel::template run<16>(args...);
+	}
+
+	// 2 for AVX-512, 1 for AVX2, 0 for the baseline; checked once
+	static int level() {
+#ifdef ARRAY_KERNELS_X86
+		static const int l = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+		                     __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl") ? 2
+		                     : __builtin_cpu_supports("avx2") ? 1 : 0;
+		return l;
+#else
+		return 0;
+#endif
+	}
+
+	template <typename Kernel, typename R, typename... Args>
+	static R run(Args... args) {
+#ifdef ARRAY_KERNELS_X86
+		switch (level()) {
+		case 2: return runAVX512<Kernel, R>(args...);
+		case 1: return runAVX2<Kernel, R>(args...);
+		}
+#endif
+		return runBaseline<Kernel, R>(args...);
+	}
+
+	// === BULK OPERATIONS ===
+
+	static long indexOf(const T* p, long n, T x) {
+		return run<IndexOf, long>(p, n, x);
+	}
+
+	static long lastIndexOf(const T* p, long n, T x) {
+		return run<LastIndexOf, long>(p, n, x);
+	}
+
+	static long count(const T* p, long n, T x) {
+		return run<Count, long>(p, n, x);
+	}
+
+	static T sum(const T* p, long n) {
+		return run<Sum, T>(p, n);
+	}
+
+	static T min(const T* p, long n) {
+		assert(n > 0);
+		return run<Extreme<false>, T>(p, n);
+	}
+
+	static T max(const T* p, long n) {
+		assert(n > 0);
+		return run<Extreme<true>, T>(p, n);
+	}
+
+	static void reverse(T* p, long n) {
+		run<Reverse, void>(p, n);
+	}
+
+	template <typename Pred>
+	static long filter(const T* p, long n, T* out, Pred pred) {
+		return run<Filter, long>(p, n, out, pred);
+	}
+};
+
+#endif // ARRAY_KERNELS_HPP
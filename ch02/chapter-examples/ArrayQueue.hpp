@@ -1,18 +1,22 @@
 #ifndef ARRAY_QUEUE_HPP
 #define ARRAY_QUEUE_HPP
 
+#include "../../common/OutputWriter.hpp"
 #include "Array.hpp"
+#include "Snapshot.hpp"
 #include <iostream>
+#include <type_traits>
 
-// Implements FIFO Queue interface with a ciruclar array using modular arithmetic
-template <typename T>
+// Implements FIFO Queue interface with a ciruclar array using modular arithmetic.
+// Alloc allocates the array (see ArrayAllocators.hpp).
+template <typename T, typename Alloc = NewAllocator>
 class ArrayQueue {
 public:
-	Array<T> a;
+	Array<T, Alloc> a;
 	int j;
 	int n;
 
-	ArrayQueue() : a(n = 0) {}
+	ArrayQueue() : a(n = 0), j(0) {}
 
 	int size() {
 		return n;
@@ -65,7 +69,7 @@ public:
 
 	void resize() {
 		// Create a new array that is double the size of the backing array
-		Array<T> b(std::max(2*n, 1));
+		Array<T, Alloc> b(std::max(2*n, 1));
 
 		// Copy n elements from a to b
 		for (int k = 0; k < n; k++) {
@@ -79,6 +83,44 @@ public:
 		j = 0;
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp). The circular
+	// array is written as its two contiguous pieces, in list order.
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		int first = std::min(n, a.length - j);
+		w.write(a.a + j, first * sizeof(T));
+		w.write(a.a, (n - first) * sizeof(T));
+		return w.finish(n);
+	}
+
+	// Replace the elements with those of a snapshot, read straight into a new
+	// backing array
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		int m = r.header.count;
+		Array<T, Alloc> b(std::max(2*m, 1));
+
+		if (!r.read(b.a, m * sizeof(T)) || !r.finish()) {
+			b.release();
+			return false;
+		}
+
+		a = b;
+		j = 0;
+		n = m;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -119,17 +161,7 @@ public:
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
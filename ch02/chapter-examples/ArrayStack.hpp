@@ -1,14 +1,24 @@
 #ifndef ARRAY_STACK_HPP
 #define ARRAY_STACK_HPP
 
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
 #include "Array.hpp"
+#include "ArrayKernels.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <random>
+#include <type_traits>
 
-// Implements the List interface using a backing array
-template <typename T>
+// Implements the List interface using a backing array, allocated by Alloc
+// (see ArrayAllocators.hpp)
+template <typename T, typename Alloc = NewAllocator>
 class ArrayStack {
 public:
-	Array<T> a;
+	Array<T, Alloc> a;
 	int n;
 
 	ArrayStack() : a(n = 0) {}
@@ -65,11 +75,69 @@ public:
 		return x;
 	}
 
+	// Reverse the elements in place. For arithmetic T, the kernel swaps and
+	// reverses a block from each end at a time (see ArrayKernels.hpp).
+	void reverse() {
+		if constexpr (hasArrayKernels<T>) {
+			ArrayKernels<T>::reverse(a.a, n);
+		} else {
+			std::reverse(a.a, a.a + n);
+		}
+	}
+
+	// === BULK OPERATIONS ===
+
+	// Searches and reductions over the backing array for arithmetic T, a
+	// block of elements at a time (see ArrayKernels.hpp)
+
+	// Index of the first element equal to x, or -1
+	int indexOf(T x) {
+		return ArrayKernels<T>::indexOf(a.a, n, x);
+	}
+
+	bool contains(T x) {
+		return indexOf(x) >= 0;
+	}
+
+	int count(T x) {
+		return ArrayKernels<T>::count(a.a, n, x);
+	}
+
+	// The stack must not be empty
+	T min() {
+		return ArrayKernels<T>::min(a.a, n);
+	}
+
+	T max() {
+		return ArrayKernels<T>::max(a.a, n);
+	}
+
+	T sum() {
+		return ArrayKernels<T>::sum(a.a, n);
+	}
+
+	// Append the elements for which pred holds to out, e.g.
+	// filter(ArrayKernels<T>::Greater(10), out), and return how many
+	template <typename Pred>
+	int filter(Pred pred, ArrayStack<T, Alloc>& out) {
+		// Make room for every element at once, so the kernel writes straight
+		// into out's array
+		if (out.a.length < out.n + n) {
+			Array<T, Alloc> b(out.n + n);
+			std::copy(out.a.a, out.a.a + out.n, b.a);
+			out.a = b;
+		}
+
+		int k = ArrayKernels<T>::filter(a.a, n, out.a.a + out.n, pred);
+		out.n += k;
+		return k;
+	}
+
 	// === GROWING / SHRINKING ===
 	
 	void resize() {
 		// Create a new array of size 2n
-		Array<T> b(std::max(2*n, 1));
+		Array<T, Alloc> b(std::max(2*n, 1));
 
 		// Copy n elements from a to new array b
 		for (int i = 0; i < n; i++) {
@@ -80,6 +148,40 @@ public:
 		a = b;
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp)
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		w.write(a.a, n * sizeof(T));
+		return w.finish(n);
+	}
+
+	// Replace the elements with those of a snapshot, read straight into a new
+	// backing array
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		int m = r.header.count;
+		Array<T, Alloc> b(std::max(2*m, 1));
+
+		if (!r.read(b.a, m * sizeof(T)) || !r.finish()) {
+			b.release();
+			return false;
+		}
+
+		a = b;
+		n = m;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -117,21 +219,157 @@ public:
 		std::cout << "ArrayStack.set(index: 1, value: 4)" << std::endl;
 
 		this->printAllElements();
+		this->reverse();
+		std::cout << "ArrayStack.reverse()" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "ArrayStack.indexOf(value: 4) = " << this->indexOf(4) << ", ArrayStack.sum() = "
+		          << this->sum() << ", ArrayStack.max() = " << this->max() << std::endl;
+		std::cout << std::endl;
 	}
 
-	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
+	// Time the bulk operations against the get() loops they replace, on 16M
+	// elements
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack bulk operations vs get() loops" << std::endl;
+		std::cout << "===" << std::endl;
 
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
+		const int count = 1 << 24;
+		ArrayStack<T> s;
+
+		for (int i = 0; i < count; i++) {
+			s.add(i, (T)(i % 100));
 		}
-		std::cout << "]" << std::endl;
+
+		// A value that is not there, so searches go to the end
+		const T missing = (T)100;
+
+		time("indexOf", [&]() {
+			for (int i = 0; i < s.size(); i++) {
+				if (s.get(i) == missing) return (double)i;
+			}
+			return -1.0;
+		}, [&]() { return (double)s.indexOf(missing); });
+
+		time("count", [&]() {
+			int c = 0;
+			for (int i = 0; i < s.size(); i++) {
+				c += s.get(i) == (T)7;
+			}
+			return (double)c;
+		}, [&]() { return (double)s.count((T)7); });
+
+		time("sum", [&]() {
+			T total = 0;
+			for (int i = 0; i < s.size(); i++) {
+				total += s.get(i);
+			}
+			return (double)total;
+		}, [&]() { return (double)s.sum(); });
+
+		time("max", [&]() {
+			T high = s.get(0);
+			for (int i = 1; i < s.size(); i++) {
+				if (s.get(i) > high) high = s.get(i);
+			}
+			return (double)high;
+		}, [&]() { return (double)s.max(); });
+
+		time("filter", [&]() {
+			ArrayStack<T> out;
+			for (int i = 0; i < s.size(); i++) {
+				if (s.get(i) > (T)97) out.add(out.size(), s.get(i));
+			}
+			out.a.release();
+			return (double)out.size();
+		}, [&]() {
+			ArrayStack<T> out;
+			s.filter(typename ArrayKernels<T>::Greater((T)97), out);
+			out.a.release();
+			return (double)out.size();
+		});
+
+		s.a.release();
+		std::cout << std::endl;
+	}
+
+	// Follow a random cycle through a 256 MiB stack of longs, allocated by
+	// each allocator in turn. Every step loads from an unpredictable page, so
+	// the time is dominated by TLB and cache misses.
+	static void allocatorBenchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack allocators: random access over 256 MiB" << std::endl;
+		std::cout << "===" << std::endl;
+
+		long expected = chase<NewAllocator>("new T[]", -1);
+		chase<CacheLineAllocator>("CacheLineAllocator", expected);
+		chase<HugePageAllocator>("HugePageAllocator", expected);
 		std::cout << std::endl;
 	}
+
+	// Follow the cycle with allocator A, and return where it ends, which
+	// should be expected (-1 for the first run, which has nothing to match)
+	template <typename A>
+	static long chase(const char* name, long expected) {
+		const int count = 1 << 25;
+		const int steps = 1 << 24;
+
+		ArrayStack<long, A> s;
+		Array<long, A> b(count);
+		s.a = b;
+		s.n = count;
+
+		// Sattolo's shuffle makes one cycle through every element
+		std::mt19937_64 rng(1);
+		for (int i = 0; i < count; i++) {
+			s.a.a[i] = i;
+		}
+		for (int i = count - 1; i > 0; i--) {
+			std::swap(s.a.a[i], s.a.a[rng() % i]);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		long k = 0;
+		for (int i = 0; i < steps; i++) {
+			k = s.a.a[k];
+		}
+		double seconds = secondsSince(start);
+
+		std::cout << name << ": " << steps << " dependent loads in " << seconds << " s ("
+		          << seconds * 1e9 / steps << " ns each)" << mismatch(expected < 0 || k == expected)
+		          << std::endl;
+
+		s.a.release();
+		return k;
+	}
+
+	// Print how long the loop and the kernel take, and whether they agree
+	template <typename Loop, typename Kernel>
+	static void time(const char* name, Loop loop, Kernel kernel) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		double expected = loop();
+		double loopSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		double result = kernel();
+		double kernelSeconds = secondsSince(start);
+
+		// A float sum is added up in a different order, and the rounding of
+		// 16M additions drifts by a few percent either way, so it only has to
+		// be close
+		bool agree = std::is_floating_point<T>::value
+		             ? std::abs(result - expected) <= 0.1 * std::abs(expected)
+		             : result == expected;
+
+		std::cout << name << ": get() loop " << loopSeconds << " s, kernel " << kernelSeconds << " s"
+		          << mismatch(agree) << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
 };
 
 #endif // ARRAY_STACK_HPP
@@ -0,0 +1,289 @@
+#ifndef CONCURRENT_ROOTISH_ARRAY_STACK_HPP
+#define CONCURRENT_ROOTISH_ARRAY_STACK_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "RootishArrayStack.hpp"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// An append-only RootishArrayStack that many threads add to and read from at
+// once, without locks. Block b holds b+1 elements, as in RootishArrayStack,
+// and a block is never moved or freed once it exists, so an element stays
+// where it was written.
+//
+// The table of blocks is sized when the stack is made, from the number of
+// blocks asked for, which fixes its capacity: m blocks hold m(m+1)/2
+// elements, and the table costs 8 bytes a block even before any are used. add() claims the next index
+// with a compare-and-swap on n that fails once the stack is full, so n never
+// passes the capacity and every index below size() has a block. The thread that
+// first needs a block allocates it and installs it with a compare-and-swap;
+// a thread that loses the race frees its copy and uses the winner's. Each
+// element has a ready flag, set with release order after the element is
+// written, so a reader that sees the flag (with acquire order) also sees the
+// element.
+//
+// size() counts claimed indices, which may not all be written yet: get()
+// waits for its element, tryGet() does not.
+template <typename T>
+class ConcurrentRootishArrayStack {
+public:
+	struct Slot {
+		T value;
+		std::atomic<bool> ready;
+
+		Slot() : value(), ready(false) {}
+	};
+
+	// 2^16 blocks hold over 2^31 elements, in a 512 KiB table. Pass a
+	// smaller maxBlocks for many small stacks, or a larger one past 2^31.
+	static const int defaultMaxBlocks = 1 << 16;
+
+	int maxBlocks;
+	long capacity;   // maxBlocks(maxBlocks+1)/2 elements
+	std::atomic<Slot*>* blocks;
+	std::atomic<long> n;
+
+	explicit ConcurrentRootishArrayStack(int maxBlocks = defaultMaxBlocks)
+		: maxBlocks(maxBlocks), capacity((long)maxBlocks*(maxBlocks + 1)/2),
+		  blocks(new std::atomic<Slot*>[maxBlocks]), n(0) {
+		for (int b = 0; b < maxBlocks; b++) {
+			blocks[b].store(NULL, std::memory_order_relaxed);
+		}
+	}
+
+	// Only once no other thread uses the stack any more
+	~ConcurrentRootishArrayStack() {
+		for (int b = 0; b < maxBlocks; b++) {
+			delete[] blocks[b].load(std::memory_order_relaxed);
+		}
+		delete[] blocks;
+	}
+
+	ConcurrentRootishArrayStack(const ConcurrentRootishArrayStack&) = delete;
+	ConcurrentRootishArrayStack& operator=(const ConcurrentRootishArrayStack&) = delete;
+
+	long size() {
+		return n.load(std::memory_order_acquire);
+	}
+
+	// Determine which block b contains i using a quadratic equation. In
+	// doubles the root can be off by one for large i, so the block is
+	// checked against its first index.
+	static int i2b(long i) {
+		int b = (int)ceil((-3.0 + sqrt(9.0 + 8.0*i)) / 2.0);
+
+		while (b > 0 && (long)b*(b + 1)/2 > i) b--;
+		while ((long)(b + 1)*(b + 2)/2 <= i) b++;
+		return b;
+	}
+
+	// === BASICS ===
+
+	// Append x and return its index. Throws std::length_error once the
+	// stack holds capacity elements.
+	long add(const T& x) {
+		// Claim index i; no other thread gets it
+		long i = n.load(std::memory_order_relaxed);
+		do {
+			if (i >= capacity) {
+				throw std::length_error("ConcurrentRootishArrayStack is full at "
+				                        + std::to_string(capacity) + " elements ("
+				                        + std::to_string(maxBlocks) + " blocks)");
+			}
+		} while (!n.compare_exchange_weak(i, i + 1, std::memory_order_relaxed));
+
+		// Calculate which block contains i and where in it i is
+		int b = i2b(i);
+		long j = i - (long)b*(b + 1)/2;
+
+		Slot* block = blocks[b].load(std::memory_order_acquire);
+		if (block == NULL) block = grow(b);
+
+		// Write the element, then publish it
+		block[j].value = x;
+		block[j].ready.store(true, std::memory_order_release);
+		return i;
+	}
+
+	// Copy element i into x if it has been written, without waiting
+	bool tryGet(long i, T& x) {
+		assert(i >= 0 && i < size());
+
+		int b = i2b(i);
+		Slot* block = blocks[b].load(std::memory_order_acquire);
+		if (block == NULL) return false;
+
+		Slot& slot = block[i - (long)b*(b + 1)/2];
+		if (!slot.ready.load(std::memory_order_acquire)) return false;
+
+		x = slot.value;
+		return true;
+	}
+
+	// Element i, waiting for the thread that claimed it to write it
+	T get(long i) {
+		T x;
+		while (!tryGet(i, x)) {
+			std::this_thread::yield();
+		}
+		return x;
+	}
+
+	// === GROWING ===
+
+	// Install block b unless another thread already has, and return it
+	Slot* grow(int b) {
+		Slot* fresh = new Slot[b + 1];
+		Slot* expected = NULL;
+
+		if (blocks[b].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel,
+		                                      std::memory_order_acquire)) {
+			return fresh;
+		}
+
+		// Lost the race: expected now holds the winner's block
+		delete[] fresh;
+		return expected;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "ConcurrentRootishArrayStack: A Lock-Free Append-Only RootishArrayStack" << std::endl;
+		std::cout << "===" << std::endl;
+
+		// Four threads append 0..4, 10..14, 20..24 and 30..34
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++) {
+			threads.emplace_back([this, t]() {
+				for (int k = 0; k < 5; k++) {
+					this->add(10*t + k);
+				}
+			});
+		}
+		for (size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+
+		std::cout << "ConcurrentRootishArrayStack.add() from 4 threads, size() = " << this->size() << std::endl;
+
+		// Each thread's elements keep their order, interleaved with the others
+		this->printAllElements();
+
+		// Three blocks hold 1 + 2 + 3 elements; the seventh add is refused
+		ConcurrentRootishArrayStack<int> small(3);
+		for (int k = 0; k < 6; k++) {
+			small.add(k);
+		}
+		try {
+			small.add(6);
+		} catch (const std::length_error& e) {
+			std::cout << "ConcurrentRootishArrayStack(maxBlocks: 3).add() after 6 elements: " << e.what() << std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	// Writers append while readers follow the log, against a RootishArrayStack
+	// behind a mutex
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ConcurrentRootishArrayStack vs RootishArrayStack with a mutex" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int writers = 4;
+		const int readers = 2;
+		const int perWriter = 1 << 20;
+		const long total = (long)writers * perWriter;
+
+		// Readers go through the log in order and sum it, so both structures
+		// must end with the same sum
+		long lockedSum = 0;
+		long lockFreeSum = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			RootishArrayStack<long> log;
+			std::mutex lock;
+			std::vector<std::thread> threads;
+
+			for (int w = 0; w < writers; w++) {
+				threads.emplace_back([&, w]() {
+					for (int k = 0; k < perWriter; k++) {
+						std::lock_guard<std::mutex> guard(lock);
+						log.add(log.size(), (long)w * perWriter + k);
+					}
+				});
+			}
+			for (int r = 0; r < readers; r++) {
+				threads.emplace_back([&]() {
+					long sum = 0;
+					for (long i = 0; i < total; ) {
+						std::lock_guard<std::mutex> guard(lock);
+						for (; i < log.size(); i++) {
+							sum += log.get(i);
+						}
+					}
+					std::lock_guard<std::mutex> guard(lock);
+					lockedSum += sum;
+				});
+			}
+			for (size_t t = 0; t < threads.size(); t++) {
+				threads[t].join();
+			}
+		}
+		double lockedSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		{
+			ConcurrentRootishArrayStack<long> log;
+			std::mutex lock;
+			std::vector<std::thread> threads;
+
+			for (int w = 0; w < writers; w++) {
+				threads.emplace_back([&, w]() {
+					for (int k = 0; k < perWriter; k++) {
+						log.add((long)w * perWriter + k);
+					}
+				});
+			}
+			for (int r = 0; r < readers; r++) {
+				threads.emplace_back([&]() {
+					long sum = 0;
+					for (long i = 0; i < total; ) {
+						for (long end = log.size(); i < end; i++) {
+							sum += log.get(i);
+						}
+						std::this_thread::yield();
+					}
+					std::lock_guard<std::mutex> guard(lock);
+					lockFreeSum += sum;
+				});
+			}
+			for (size_t t = 0; t < threads.size(); t++) {
+				threads[t].join();
+			}
+		}
+		double lockFreeSeconds = secondsSince(start);
+
+		std::cout << writers << " writers x " << perWriter << " adds, " << readers << " readers: "
+		          << "RootishArrayStack + mutex " << lockedSeconds << " s, ConcurrentRootishArrayStack "
+		          << lockFreeSeconds << " s" << mismatch(lockedSum == lockFreeSum) << std::endl;
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+#endif // CONCURRENT_ROOTISH_ARRAY_STACK_HPP
@@ -0,0 +1,338 @@
+#ifndef DARY_HEAP_HPP
+#define DARY_HEAP_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayAllocators.hpp"
+#include "FastArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+// A priority queue kept as a D-ary heap in a FastArrayStack. Element k's
+// children are D*k+1 ... D*k+D, so the heap is log_D(n) levels deep and a
+// remove compares D children per level. remove() returns the first element
+// in the order of Compare (the smallest, for std::less).
+//
+// remove() uses Floyd's method: the hole left by the root is moved down to a
+// leaf along the path of first children, without comparing them against the
+// last element, which then goes in the hole and is sifted up. The last
+// element usually belongs near the bottom, so this saves one comparison per
+// level on the way down for a short sift up. On the way down the D children
+// are compared without branches, and the level below them is prefetched, so
+// each level costs one cache miss at most, overlapped with the comparisons.
+//
+// The array starts with D-1 unused slots and comes from CacheLineAllocator,
+// so each group of D siblings starts at a multiple of D slots: with 8-byte
+// elements, the 4 children of a 4-ary node share half a cache line and the 8
+// children of an 8-ary node fill exactly one.
+template <typename T, int D = 4, typename Compare = std::less<T>>
+class DaryHeap {
+public:
+	static_assert(D >= 2, "a heap needs at least two children per node");
+
+	FastArrayStack<T, CacheLineAllocator> a;
+	Compare comp;
+
+	DaryHeap(Compare comp0 = Compare()) : comp(comp0) {
+		for (int k = 0; k < D - 1; k++) {
+			a.add(a.size(), T());
+		}
+	}
+
+	~DaryHeap() {
+		a.a.release();
+	}
+
+	DaryHeap(const DaryHeap&) = delete;
+	DaryHeap& operator=(const DaryHeap&) = delete;
+
+	int size() {
+		return a.size() - (D - 1);
+	}
+
+	// Heap element k, after the D-1 unused slots
+	T& at(int k) {
+		return a.a.a[k + D - 1];
+	}
+
+	static int parent(int k) {
+		return (k - 1) / D;
+	}
+
+	// === BASICS ===
+
+	// The first element, which remove() would return
+	T top() {
+		assert(size() > 0);
+		return at(0);
+	}
+
+	void add(T x) {
+		// Append x, then move it up to its place
+		a.add(a.size(), x);
+		siftUp(size() - 1);
+	}
+
+	T remove() {
+		assert(size() > 0);
+
+		// Take the root, move the hole down to a leaf, and put the last
+		// element there
+		T x = at(0);
+		T last = a.remove(a.size() - 1);
+
+		if (size() > 0) {
+			int k = sinkHole(0);
+			at(k) = last;
+			siftUp(k);
+		}
+		return x;
+	}
+
+	// Move element k up while it comes before its parent. The element is
+	// held aside and parents move down into the hole, so each level costs
+	// one move instead of a swap.
+	void siftUp(int k) {
+		T x = at(k);
+
+		while (k > 0 && comp(x, at(parent(k)))) {
+			at(k) = at(parent(k));
+			k = parent(k);
+		}
+		at(k) = x;
+	}
+
+	// Move the hole at k down to a leaf, filling it with the first of its
+	// children at each level, and return where it ends up
+	int sinkHole(int k) {
+		int n = size();
+		int first = D*k + 1;
+
+		// While k has all D children, they are compared without branches
+		for (; first + D <= n; first = D*k + 1) {
+			// Start loading the next level down, the children of all D
+			// children, while these are compared. (This stays inline: GCC
+			// treats a function that only prefetches as having no effect and
+			// drops the call.)
+			int next = D*first + 1;
+			for (int c = next; c < std::min(next + D*D, n); c += 64 / sizeof(T)) {
+				__builtin_prefetch(&at(c));
+			}
+
+			int best = firstOfAll(first);
+			at(k) = at(best);
+			k = best;
+		}
+
+		// At most one node has fewer than D children
+		if (first < n) {
+			int best = firstOf(first, n);
+			at(k) = at(best);
+			k = best;
+		}
+		return k;
+	}
+
+	// Index of the first of the D elements first ... first+D-1. The best so
+	// far is kept with selects rather than branches: which child comes first
+	// is random, so a branch would be mispredicted at almost every level.
+	// Without branches the CPU cannot guess its way to the next level,
+	// which is why sinkHole() prefetches it instead.
+	int firstOfAll(int first) {
+		int best = first;
+		T x = at(first);
+
+		for (int c = first + 1; c < first + D; c++) {
+			T y = at(c);
+			bool earlier = comp(y, x);
+			best = earlier ? c : best;
+			x = earlier ? y : x;
+		}
+		return best;
+	}
+
+	// Move element k down while one of its children comes before it
+	void siftDown(int k) {
+		int n = size();
+		T x = at(k);
+
+		for (;;) {
+			int first = D*k + 1;
+			if (first >= n) break;
+
+			int best = firstOf(first, std::min(first + D, n));
+			if (!comp(at(best), x)) break;
+			at(k) = at(best);
+			k = best;
+		}
+		at(k) = x;
+	}
+
+	// Index of the first of elements first ... last-1
+	int firstOf(int first, int last) {
+		int best = first;
+		for (int c = first + 1; c < last; c++) {
+			if (comp(at(c), at(best))) best = c;
+		}
+		return best;
+	}
+
+	// === BULK OPERATIONS ===
+
+	// Replace the contents with xs[0 ... count-1] and make them a heap in
+	// O(count), instead of O(count log count) for count adds
+	void heapify(const T* xs, int count) {
+		a.n = D - 1;
+		addN(xs, count);
+	}
+
+	// Add xs[0 ... count-1]. When count is at least the current size, the
+	// whole array is rebuilt bottom-up in O(n); otherwise each one is sifted
+	// up on its own.
+	void addN(const T* xs, int count) {
+		int old = size();
+
+		for (int k = 0; k < count; k++) {
+			a.add(a.size(), xs[k]);
+		}
+
+		if (count >= old) {
+			// Sift down every node that has children, last first
+			for (int k = parent(size() - 1); k >= 0 && size() > 1; k--) {
+				siftDown(k);
+			}
+		} else {
+			for (int k = old; k < size(); k++) {
+				siftUp(k);
+			}
+		}
+	}
+
+	// Remove up to count elements into out, in order, and return how many
+	int removeN(int count, T* out) {
+		int k = 0;
+		for (; k < count && size() > 0; k++) {
+			out[k] = remove();
+		}
+		return k;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "DaryHeap: A " << D << "-ary Heap Priority Queue" << std::endl;
+		std::cout << "===" << std::endl;
+
+		int values[] = { 9, 4, 7, 1, 8, 2, 6, 3, 5 };
+		this->heapify(values, 9);
+		std::cout << "DaryHeap.heapify([9, 4, 7, 1, 8, 2, 6, 3, 5])" << std::endl;
+
+		this->printAllElements();
+
+		this->add(0);
+		std::cout << "DaryHeap.add(value: 0), top() = " << this->top() << std::endl;
+
+		int out[4];
+		int got = this->removeN(4, out);
+		std::cout << "DaryHeap.removeN(count: 4) = [";
+		for (int k = 0; k < got; k++) {
+			std::cout << out[k] << (k < got - 1 ? ", " : "]");
+		}
+		std::cout << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Push count random elements one at a time and pop them all, then load
+	// them in bulk with heapify, for binary, 4-ary and 8-ary heaps and
+	// std::priority_queue
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "Binary vs 4-ary vs 8-ary DaryHeap vs std::priority_queue" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int count = 1 << 22;
+		std::vector<T> values(count);
+		std::mt19937 rng(17);
+		for (int k = 0; k < count; k++) {
+			values[k] = (T)rng();
+		}
+
+		// Popping everything must give the same sequence everywhere, so a
+		// position-weighted sum of it is compared
+		long expected = run<DaryHeap<T, 2, Compare>>("DaryHeap<2>", values);
+		bool agree = run<DaryHeap<T, 4, Compare>>("DaryHeap<4>", values) == expected;
+		agree = run<DaryHeap<T, 8, Compare>>("DaryHeap<8>", values) == expected && agree;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::priority_queue<T, std::vector<T>, Inverse> queue;
+		for (int k = 0; k < count; k++) {
+			queue.push(values[k]);
+		}
+		double pushSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		long checksum = 0;
+		for (long k = 0; !queue.empty(); k++) {
+			checksum += (long)queue.top() * (k % 7 + 1);
+			queue.pop();
+		}
+		double popSeconds = secondsSince(start);
+
+		std::cout << "std::priority_queue: " << count << " pushes " << pushSeconds << " s, pops " << popSeconds
+		          << " s" << mismatch(agree && checksum == expected) << std::endl;
+		std::cout << std::endl;
+	}
+
+	// std::priority_queue puts the last element in Compare order on top
+	struct Inverse {
+		Compare comp;
+
+		bool operator()(const T& x, const T& y) const {
+			return comp(y, x);
+		}
+	};
+
+	// Time count adds, count removes and a heapify on Heap, and return the
+	// checksum of the removed sequence
+	template <typename Heap>
+	static long run(const char* name, std::vector<T>& values) {
+		int count = values.size();
+		Heap heap;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int k = 0; k < count; k++) {
+			heap.add(values[k]);
+		}
+		double pushSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		long checksum = 0;
+		for (long k = 0; heap.size() > 0; k++) {
+			checksum += (long)heap.remove() * (k % 7 + 1);
+		}
+		double popSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		heap.heapify(values.data(), count);
+		double heapifySeconds = secondsSince(start);
+
+		std::cout << name << ": " << count << " adds " << pushSeconds << " s, removes " << popSeconds
+		          << " s, heapify " << heapifySeconds << " s" << std::endl;
+		return checksum;
+	}
+
+	// The elements in array order, which is not sorted order
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->at(i); });
+	}
+};
+
+#endif // DARY_HEAP_HPP
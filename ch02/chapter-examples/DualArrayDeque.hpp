@@ -1,12 +1,16 @@
 #ifndef DUAL_ARRAY_DEQUE_HPP
 #define DUAL_ARRAY_DEQUE_HPP
 
+#include "../../common/OutputWriter.hpp"
 #include "Array.hpp"
+#include "ArrayStack.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
-
-// Forward declaration of ArrayStack.
-template <typename T>
-class ArrayStack;
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 // Achieves the same performance bounds as an ArrayDequeue with two ArrayStacks
 template <typename T>
@@ -79,6 +83,15 @@ public:
 		return x;
 	}
 
+	// Reverse the deque in O(1). front holds the first elements in reverse
+	// order and back holds the rest in order, so exchanging the two stacks
+	// reverses the list.
+	void reverse() {
+		std::swap(front.a.a, back.a.a);
+		std::swap(front.a.length, back.a.length);
+		std::swap(front.n, back.n);
+	}
+
 	// === GROWING / SHRINKING ===
 
 	void balance() {
@@ -113,6 +126,63 @@ public:
 		}
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp), in list order.
+	// front stores its elements backwards, so they are copied out from last
+	// to first through a small buffer, leaving front untouched.
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		const int chunk = std::max<int>(4096 / sizeof(T), 1);
+		std::vector<char> buffer(std::min(chunk, front.n) * sizeof(T));
+
+		for (int i = front.n; i > 0; ) {
+			int count = std::min(chunk, i);
+			for (int k = 0; k < count; k++) {
+				memcpy(&buffer[k * sizeof(T)], &front.a.a[i - 1 - k], sizeof(T));
+			}
+			w.write(buffer.data(), count * sizeof(T));
+			i -= count;
+		}
+
+		w.write(back.a.a, back.n * sizeof(T));
+		return w.finish(size());
+	}
+
+	// Replace the elements with those of a snapshot. The first half is read
+	// into a new front array and reversed, the second half into a new back
+	// array, which leaves the two balanced.
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		int n = r.header.count;
+		int nf = n/2;
+		int nb = n - nf;
+		Array<T> af(std::max(2 * nf, 1));
+		Array<T> ab(std::max(2 * nb, 1));
+
+		if (!r.read(af.a, nf * sizeof(T)) || !r.read(ab.a, nb * sizeof(T)) || !r.finish()) {
+			af.release();
+			ab.release();
+			return false;
+		}
+
+		std::reverse(af.a, af.a + nf);
+
+		front.a = af;
+		front.n = nf;
+		back.a = ab;
+		back.n = nb;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -149,21 +219,15 @@ public:
 		this->set(1, 4);
 		std::cout << "DualArrayDeque.set(index: 1, value: 4)" << std::endl;
 
+		this->printAllElements();
+		this->reverse();
+		std::cout << "DualArrayDeque.reverse()" << std::endl;
+
 		this->printAllElements();
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
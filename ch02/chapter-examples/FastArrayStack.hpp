@@ -1,14 +1,20 @@
 #ifndef FAST_ARRAY_STACK_HPP
 #define FAST_ARRAY_STACK_HPP
 
+#include "../../common/OutputWriter.hpp"
 #include "Array.hpp"
+#include "ArrayKernels.hpp"
+#include "Snapshot.hpp"
+#include <algorithm>
 #include <iostream>
+#include <type_traits>
 
-// Implements the List interface using a backing array
-template <typename T>
+// Implements the List interface using a backing array, allocated by Alloc
+// (see ArrayAllocators.hpp)
+template <typename T, typename Alloc = NewAllocator>
 class FastArrayStack {
 public:
-	Array<T> a;
+	Array<T, Alloc> a;
 	int n;
 
 	FastArrayStack() : a(n = 0) {}
@@ -50,7 +56,7 @@ public:
 		T x = a[i];
 
 		// Shift elements a[i+1:n-1] left by one position efficiently
-		std::copy_backward(a.a + i, a.a + n, a.a + n - 1);
+		std::copy(a.a + i + 1, a.a + n, a.a + i);
 
 		// Decrement n
 		n--;
@@ -61,11 +67,69 @@ public:
 		return x;
 	}
 
+	// Reverse the elements in place. For arithmetic T, the kernel swaps and
+	// reverses a block from each end at a time (see ArrayKernels.hpp).
+	void reverse() {
+		if constexpr (hasArrayKernels<T>) {
+			ArrayKernels<T>::reverse(a.a, n);
+		} else {
+			std::reverse(a.a, a.a + n);
+		}
+	}
+
+	// === BULK OPERATIONS ===
+
+	// Searches and reductions over the backing array for arithmetic T, a
+	// block of elements at a time (see ArrayKernels.hpp)
+
+	// Index of the first element equal to x, or -1
+	int indexOf(T x) {
+		return ArrayKernels<T>::indexOf(a.a, n, x);
+	}
+
+	bool contains(T x) {
+		return indexOf(x) >= 0;
+	}
+
+	int count(T x) {
+		return ArrayKernels<T>::count(a.a, n, x);
+	}
+
+	// The stack must not be empty
+	T min() {
+		return ArrayKernels<T>::min(a.a, n);
+	}
+
+	T max() {
+		return ArrayKernels<T>::max(a.a, n);
+	}
+
+	T sum() {
+		return ArrayKernels<T>::sum(a.a, n);
+	}
+
+	// Append the elements for which pred holds to out, e.g.
+	// filter(ArrayKernels<T>::Greater(10), out), and return how many
+	template <typename Pred>
+	int filter(Pred pred, FastArrayStack<T, Alloc>& out) {
+		// Make room for every element at once, so the kernel writes straight
+		// into out's array
+		if (out.a.length < out.n + n) {
+			Array<T, Alloc> b(out.n + n);
+			std::copy(out.a.a, out.a.a + out.n, b.a);
+			out.a = b;
+		}
+
+		int k = ArrayKernels<T>::filter(a.a, n, out.a.a + out.n, pred);
+		out.n += k;
+		return k;
+	}
+
 	// === GROWING / SHRINKING ===
 	
 	void resize() {
 		// Create a new array of size 2n
-		Array<T> b(std::max(1, 2 * n));
+		Array<T, Alloc> b(std::max(1, 2 * n));
 
 		// Copy n elements from a to b using efficient std::copy algorithm
 		std::copy(a.a + 0, a.a +n, b.a + 0);
@@ -74,6 +138,40 @@ public:
 		a = b;
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp)
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		w.write(a.a, n * sizeof(T));
+		return w.finish(n);
+	}
+
+	// Replace the elements with those of a snapshot, read straight into a new
+	// backing array
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		int m = r.header.count;
+		Array<T, Alloc> b(std::max(2*m, 1));
+
+		if (!r.read(b.a, m * sizeof(T)) || !r.finish()) {
+			b.release();
+			return false;
+		}
+
+		a = b;
+		n = m;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -111,20 +209,18 @@ public:
 		std::cout << "FastArrayStack.set(index: 1, value: 4)" << std::endl;
 
 		this->printAllElements();
+		this->reverse();
+		std::cout << "FastArrayStack.reverse()" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "FastArrayStack.indexOf(value: 4) = " << this->indexOf(4) << ", FastArrayStack.sum() = "
+		          << this->sum() << ", FastArrayStack.max() = " << this->max() << std::endl;
+		std::cout << std::endl;
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
@@ -0,0 +1,214 @@
+#ifndef GAP_BUFFER_HPP
+#define GAP_BUFFER_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "Array.hpp"
+#include "ArrayStack.hpp"
+#include "FastArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+// Implements the List interface using a backing array with a gap of unused
+// slots in it. Elements 0 ... gap-1 sit before the gap and the rest after it.
+// The gap is left where the last add or remove happened, so an edit close to
+// the previous one only moves the elements between the two positions instead
+// of everything after the edit, as ArrayStack does.
+template <typename T, typename Alloc = NewAllocator>
+class GapBuffer {
+public:
+	Array<T, Alloc> a;
+	int gap;      // index of the first slot of the gap
+	int gapEnd;   // index of the first slot after it
+	int n;
+
+	GapBuffer() : a(n = 0), gap(0), gapEnd(0) {}
+
+	int size() {
+		return n;
+	}
+
+	// === BASICS ===
+
+	// Position of element i in a, skipping the gap
+	int slot(int i) {
+		return i < gap ? i : i + (gapEnd - gap);
+	}
+
+	T get(int i) {
+		// Return the value at index i
+		assert(i >= 0 && i < n);
+		return a[slot(i)];
+	}
+
+	T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T y = a[slot(i)];
+
+		// Set it to x and return the old value
+		a[slot(i)] = x;
+		return y;
+	}
+
+	void add(int i, T x) {
+		assert(i >= 0 && i <= n);
+
+		// Check if the gap is used up. If so, resize so that a.length > n
+		if (gap == gapEnd) resize();
+
+		// Move the gap to i, then fill its first slot
+		moveGap(i);
+		a[gap++] = x;
+		n++;
+	}
+
+	T remove(int i) {
+		assert(i >= 0 && i < n);
+
+		// Move the gap to i, so element i is the first one after it, and
+		// widen the gap over it
+		moveGap(i);
+		T x = a[gapEnd++];
+		n--;
+
+		// Check if n is getting too small (less than 1/3 full)
+		if (a.length >= 3*n) resize();
+
+		return x;
+	}
+
+	// Move the gap so it starts at index i, shifting the elements between
+	// the old and the new position across it
+	void moveGap(int i) {
+		if (i < gap) {
+			// Elements i ... gap-1 move to just before gapEnd
+			std::copy_backward(a.a + i, a.a + gap, a.a + gapEnd);
+			gapEnd -= gap - i;
+		} else if (i > gap) {
+			// Elements gap ... i-1 (stored from gapEnd on) move down to gap
+			std::copy(a.a + gapEnd, a.a + gapEnd + (i - gap), a.a + gap);
+			gapEnd += i - gap;
+		}
+		gap = i;
+	}
+
+	// === GROWING / SHRINKING ===
+
+	// Create a new array of size 2n, with the gap where it was
+	void resize() {
+		Array<T, Alloc> b(std::max(2*n, 1));
+		int after = n - gap;
+
+		// Copy the elements before the gap to the start, and the ones after
+		// it to the end
+		std::copy(a.a, a.a + gap, b.a);
+		std::copy(a.a + gapEnd, a.a + gapEnd + after, b.a + b.length - after);
+
+		gapEnd = b.length - after;
+		a = b;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "GapBuffer: An ArrayStack with a Movable Gap" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, 1);
+		std::cout << "GapBuffer.add(index: 0, value: 1)" << std::endl;
+		this->add(1, 2);
+		std::cout << "GapBuffer.add(index: 1, value: 2)" << std::endl;
+		this->add(2, 3);
+		std::cout << "GapBuffer.add(index: 2, value: 3)" << std::endl;
+		this->add(1, 4);
+		std::cout << "GapBuffer.add(index: 1, value: 4)" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "GapBuffer.remove(index: 2) = " << this->remove(2) << std::endl;
+
+		this->printAllElements();
+
+		this->set(0, 5);
+		std::cout << "GapBuffer.set(index: 0, value: 5)" << std::endl;
+		std::cout << "GapBuffer.get(index: 2) = " << this->get(2) << std::endl;
+
+		this->printAllElements();
+	}
+
+	// An editing session: a cursor that mostly steps a few places at a time
+	// and now and then jumps, inserting and deleting where it is, against
+	// ArrayStack and FastArrayStack
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack vs FastArrayStack vs GapBuffer: edits around a cursor" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int initial = 1 << 15;
+		const int edits = 1 << 16;
+
+		ArrayStack<T> stack;
+		FastArrayStack<T> fast;
+		GapBuffer<T> buffer;
+
+		for (int i = 0; i < initial; i++) {
+			stack.add(i, (T)i);
+			fast.add(i, (T)i);
+			buffer.add(i, (T)i);
+		}
+
+		double stackSeconds = edit(stack, edits);
+		double fastSeconds = edit(fast, edits);
+		double bufferSeconds = edit(buffer, edits);
+
+		bool agree = stack.size() == buffer.size() && fast.size() == buffer.size();
+		for (int i = 0; agree && i < buffer.size(); i++) {
+			agree = stack.get(i) == buffer.get(i) && fast.get(i) == buffer.get(i);
+		}
+
+		std::cout << edits << " edits on " << initial << " elements: ArrayStack " << stackSeconds
+		          << " s, FastArrayStack " << fastSeconds << " s, GapBuffer " << bufferSeconds << " s"
+		          << mismatch(agree) << std::endl;
+
+		stack.a.release();
+		fast.a.release();
+		buffer.a.release();
+		std::cout << std::endl;
+	}
+
+	// Run the same edit stream on any list and time it
+	template <typename List>
+	static double edit(List& list, int edits) {
+		std::mt19937 rng(7);
+		int cursor = list.size() / 2;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int k = 0; k < edits; k++) {
+			if (rng() % 1024 == 0) {
+				cursor = rng() % (list.size() + 1);
+			} else {
+				cursor = std::min(std::max(cursor + (int)(rng() % 17) - 8, 0), list.size());
+			}
+
+			// Type two characters for each one deleted
+			if (rng() % 3 != 0 || cursor == list.size()) {
+				list.add(cursor, (T)k);
+			} else {
+				list.remove(cursor);
+			}
+		}
+		return secondsSince(start);
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+#endif // GAP_BUFFER_HPP
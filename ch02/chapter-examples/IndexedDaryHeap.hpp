@@ -0,0 +1,280 @@
+#ifndef INDEXED_DARY_HEAP_HPP
+#define INDEXED_DARY_HEAP_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "FastArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+
+// A D-ary heap of ids 0, 1, 2, ..., each with a key, that can lower the key
+// of an id already in the heap. A position index records where each id sits
+// in the heap, so decreaseKey finds it in O(1) and sifts it up in
+// O(log_D n), instead of adding a second copy and skipping stale ones later.
+// remove() uses Floyd's method, as DaryHeap does.
+//
+// Unlike DaryHeap, the arrays have no leading padding and come from the
+// default allocator: siblings are ids, and their keys are scattered over the
+// key array anyway, so aligning the heap array would not keep a node's
+// children's keys in one cache line.
+template <typename T, int D = 4, typename Compare = std::less<T>>
+class IndexedDaryHeap {
+public:
+	static_assert(D >= 2, "a heap needs at least two children per node");
+
+	FastArrayStack<int> heap;   // ids in heap order
+	FastArrayStack<T> key;      // key of each id
+	FastArrayStack<int> pos;    // heap position of each id, or -1
+	Compare comp;
+
+	IndexedDaryHeap(Compare comp0 = Compare()) : comp(comp0) {}
+
+	~IndexedDaryHeap() {
+		heap.a.release();
+		key.a.release();
+		pos.a.release();
+	}
+
+	IndexedDaryHeap(const IndexedDaryHeap&) = delete;
+	IndexedDaryHeap& operator=(const IndexedDaryHeap&) = delete;
+
+	int size() {
+		return heap.size();
+	}
+
+	bool contains(int id) {
+		return id >= 0 && id < pos.size() && pos.a.a[id] >= 0;
+	}
+
+	T keyOf(int id) {
+		assert(contains(id));
+		return key.a.a[id];
+	}
+
+	static int parent(int k) {
+		return (k - 1) / D;
+	}
+
+	// === BASICS ===
+
+	// The id with the first key, which remove() would return
+	int top() {
+		assert(size() > 0);
+		return heap.a.a[0];
+	}
+
+	void add(int id, T k) {
+		assert(id >= 0 && !contains(id));
+
+		// Make room in the per-id arrays
+		while (pos.size() <= id) {
+			pos.add(pos.size(), -1);
+			key.add(key.size(), T());
+		}
+
+		key.a.a[id] = k;
+		heap.add(heap.size(), id);
+		siftUp(heap.size() - 1);
+	}
+
+	// Lower the key of id, which must be in the heap, to k
+	void decreaseKey(int id, T k) {
+		assert(contains(id) && !comp(key.a.a[id], k));
+
+		key.a.a[id] = k;
+		siftUp(pos.a.a[id]);
+	}
+
+	int remove() {
+		assert(size() > 0);
+
+		int id = heap.a.a[0];
+		int last = heap.remove(heap.size() - 1);
+		pos.a.a[id] = -1;
+
+		if (size() > 0) {
+			int k = sinkHole(0);
+			place(last, k);
+			siftUp(k);
+		}
+		return id;
+	}
+
+	// Put id at heap position k and record it
+	void place(int id, int k) {
+		heap.a.a[k] = id;
+		pos.a.a[id] = k;
+	}
+
+	void siftUp(int k) {
+		int id = heap.a.a[k];
+		T x = key.a.a[id];
+
+		while (k > 0 && comp(x, key.a.a[heap.a.a[parent(k)]])) {
+			place(heap.a.a[parent(k)], k);
+			k = parent(k);
+		}
+		place(id, k);
+	}
+
+	// Move the hole at k down to a leaf, filling it with the child with the
+	// first key at each level, and return where it ends up
+	int sinkHole(int k) {
+		int n = size();
+		int first = D*k + 1;
+
+		// While k has all D children, the loop over them has a fixed length
+		for (; first + D <= n; first = D*k + 1) {
+			int best = firstOf(first, first + D);
+			place(heap.a.a[best], k);
+			k = best;
+		}
+
+		// At most one node has fewer than D children
+		if (first < n) {
+			int best = firstOf(first, n);
+			place(heap.a.a[best], k);
+			k = best;
+		}
+		return k;
+	}
+
+	// Heap position of the first key among positions first ... last-1
+	int firstOf(int first, int last) {
+		int best = first;
+		for (int c = first + 1; c < last; c++) {
+			if (comp(key.a.a[heap.a.a[c]], key.a.a[heap.a.a[best]])) best = c;
+		}
+		return best;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "IndexedDaryHeap: A " << D << "-ary Heap with decreaseKey" << std::endl;
+		std::cout << "===" << std::endl;
+
+		T keys[] = { 50, 30, 40, 10, 20 };
+		for (int id = 0; id < 5; id++) {
+			this->add(id, keys[id]);
+		}
+		std::cout << "IndexedDaryHeap.add(id: 0 ... 4, key: 50, 30, 40, 10, 20), top() = " << this->top()
+		          << std::endl;
+
+		this->decreaseKey(2, 5);
+		std::cout << "IndexedDaryHeap.decreaseKey(id: 2, key: 5), top() = " << this->top() << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "IndexedDaryHeap.remove() = " << this->remove() << ", then " << this->remove() << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Shortest paths on a random graph with Dijkstra's algorithm: with
+	// decreaseKey, and with std::priority_queue and lazy deletion of stale
+	// entries
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "Dijkstra: IndexedDaryHeap decreaseKey vs std::priority_queue" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int vertices = 1 << 18;
+		const int degree = 8;
+
+		// Edge e of vertex v goes to target[v*degree + e] with weight
+		// weight[v*degree + e]
+		std::vector<int> target(vertices * degree);
+		std::vector<long> weight(vertices * degree);
+		std::mt19937 rng(19);
+		for (int e = 0; e < vertices * degree; e++) {
+			target[e] = rng() % vertices;
+			weight[e] = 1 + rng() % 1000;
+		}
+
+		std::vector<long> distance(vertices);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			IndexedDaryHeap<long, D> queue;
+			std::fill(distance.begin(), distance.end(), -1);
+			distance[0] = 0;
+			queue.add(0, 0);
+
+			while (queue.size() > 0) {
+				int v = queue.remove();
+				for (int e = v * degree; e < (v + 1) * degree; e++) {
+					int w = target[e];
+					long d = distance[v] + weight[e];
+
+					if (distance[w] < 0) {
+						distance[w] = d;
+						queue.add(w, d);
+					} else if (d < distance[w] && queue.contains(w)) {
+						distance[w] = d;
+						queue.decreaseKey(w, d);
+					}
+				}
+			}
+		}
+		double indexedSeconds = secondsSince(start);
+		long indexedTotal = 0;
+		for (int v = 0; v < vertices; v++) {
+			indexedTotal += distance[v];
+		}
+
+		start = std::chrono::steady_clock::now();
+		{
+			typedef std::pair<long, int> Entry;
+			std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+			std::fill(distance.begin(), distance.end(), -1);
+			distance[0] = 0;
+			queue.push(Entry(0, 0));
+
+			while (!queue.empty()) {
+				Entry top = queue.top();
+				queue.pop();
+				int v = top.second;
+				if (top.first > distance[v]) continue;
+
+				for (int e = v * degree; e < (v + 1) * degree; e++) {
+					int w = target[e];
+					long d = distance[v] + weight[e];
+
+					if (distance[w] < 0 || d < distance[w]) {
+						distance[w] = d;
+						queue.push(Entry(d, w));
+					}
+				}
+			}
+		}
+		double lazySeconds = secondsSince(start);
+		long lazyTotal = 0;
+		for (int v = 0; v < vertices; v++) {
+			lazyTotal += distance[v];
+		}
+
+		std::cout << vertices << " vertices, " << vertices * degree << " edges: IndexedDaryHeap<" << D << "> "
+		          << indexedSeconds << " s, std::priority_queue " << lazySeconds << " s"
+		          << mismatch(indexedTotal == lazyTotal) << std::endl;
+		std::cout << std::endl;
+	}
+
+	// The (id: key) pairs in heap order
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) {
+			int id = heap.a.a[i];
+			out << "(" << id << ": " << key.a.a[id] << ")";
+		});
+	}
+};
+
+#endif // INDEXED_DARY_HEAP_HPP
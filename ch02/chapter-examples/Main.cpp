@@ -4,10 +4,97 @@
 #include "ArrayDeque.hpp"
 #include "DualArrayDeque.hpp"
 #include "RootishArrayStack.hpp"
+#include "MappedArrayStack.hpp"
+#include "SmallArrayStack.hpp"
+#include "StaticArrayStack.hpp"
+#include "StaticArrayQueue.hpp"
+#include "StaticArrayDeque.hpp"
+#include "Parallel.hpp"
+#include "SoAArrayStack.hpp"
+#include "ConcurrentRootishArrayStack.hpp"
+#include "RcuSnapshot.hpp"
+#include "GapBuffer.hpp"
+#include "TieredVector.hpp"
+#include "DaryHeap.hpp"
+#include "IndexedDaryHeap.hpp"
+#include <cstring>
+
+int main(int argc, char* argv[]) {
+	ArrayStack<int> arrayStack;
+	arrayStack.test();
+
+	FastArrayStack<int> fastStack;
+	fastStack.test();
+
+	ArrayQueue<int> queue;
+	queue.test();
+
+	ArrayDeque<int> deque;
+	deque.test();
+
+	DualArrayDeque<int> dualDeque;
+	dualDeque.test();
 
-int main() {
 	RootishArrayStack<int> stack;
 	stack.test();
 
+	MappedArrayStack<int> mapped;
+	mapped.test();
+
+	SmallArrayStack<int, 4> small;
+	small.test();
+
+	StaticArrayStack<int, 4> staticStack;
+	staticStack.test();
+
+	StaticArrayQueue<int, 4> staticQueue;
+	staticQueue.test();
+
+	StaticArrayDeque<int, 4> staticDeque;
+	staticDeque.test();
+
+	Parallel::test();
+
+	SoAArrayStack<int, double> records;
+	records.test();
+
+	ConcurrentRootishArrayStack<int> concurrent;
+	concurrent.test();
+
+	RcuSnapshot<ArrayStack<int>> snapshot;
+	snapshot.test();
+
+	GapBuffer<int> gapBuffer;
+	gapBuffer.test();
+
+	TieredVector<int> tiered;
+	tiered.test();
+
+	DaryHeap<int> heap;
+	heap.test();
+
+	IndexedDaryHeap<int> indexedHeap;
+	indexedHeap.test();
+
+	// The benchmarks take minutes between them, so they only run when asked for
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		OutputWriter::benchmark();
+		MappedArrayStack<long>::benchmark();
+		SmallArrayStack<int>::benchmark();
+		StaticArrayStack<int, 1024>::benchmark();
+		StaticArrayQueue<int, 1024>::benchmark();
+		StaticArrayDeque<int, 1024>::benchmark();
+		ArrayStack<int>::benchmark();
+		Parallel::benchmark();
+		SoAArrayStack<int, double>::benchmark();
+		ArrayStack<long>::allocatorBenchmark();
+		ConcurrentRootishArrayStack<long>::benchmark();
+		RcuSnapshot<ArrayStack<long>>::benchmark();
+		GapBuffer<int>::benchmark();
+		TieredVector<int>::benchmark();
+		DaryHeap<long>::benchmark();
+		IndexedDaryHeap<int>::benchmark();
+	}
+
 	return 0;
 }
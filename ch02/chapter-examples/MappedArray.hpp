@@ -0,0 +1,151 @@
+#ifndef MAPPED_ARRAY_HPP
+#define MAPPED_ARRAY_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// An array whose memory is a mapping instead of a heap block: anonymous
+// memory, or a file so the array can grow past RAM and outlive the process.
+// resize() remaps with mremap, which moves page table entries rather than
+// bytes, so the elements are never copied however large the array grows.
+//
+// A file may start with header bytes of the owner's, ahead of element 0. They
+// are mapped with the elements, so whatever the owner keeps there reaches
+// the file along with them.
+template <typename T>
+class MappedArray {
+public:
+	static_assert(std::is_trivially_copyable<T>::value, "mapped arrays hold raw bytes");
+
+	T *a;
+	long length;
+	char* base;     // start of the mapping: the header, then a[0]
+	size_t header;  // bytes of a file before a[0], 0 for anonymous memory
+	size_t mapped;  // bytes mapped, header and length rounded up to whole pages
+	int fd;         // -1 for anonymous memory
+	int advice;     // madvise() hint, reapplied after every remap
+
+	// Anonymous mapping of len elements
+	MappedArray(long len = 0)
+	    : a(NULL), length(0), base(NULL), header(0), mapped(0), fd(-1), advice(MADV_NORMAL) {
+		resize(len);
+	}
+
+	~MappedArray() {
+		if (base != NULL) munmap(base, mapped);
+
+		// Trim the file to exactly the header and the elements in the array. If
+		// that fails the file just keeps some zeroed elements at the end.
+		if (fd >= 0) {
+			int trimmed = ftruncate(fd, header + length * sizeof(T));
+			(void)trimmed;
+			close(fd);
+		}
+	}
+
+	MappedArray(const MappedArray&) = delete;
+	MappedArray& operator=(const MappedArray&) = delete;
+
+	// Back the array with the file at path, creating it if it does not exist.
+	// The file starts with header0 bytes, zeroed in a new file, and the array
+	// takes the elements after them. Returns false if the file could not be
+	// opened or mapped.
+	bool open(const char* path, size_t header0 = 0) {
+		int f = ::open(path, O_RDWR | O_CREAT, 0644);
+		if (f < 0) return false;
+
+		struct stat st;
+		if (fstat(f, &st) != 0) {
+			close(f);
+			return false;
+		}
+
+		// Drop the current memory and map the file instead
+		if (base != NULL) munmap(base, mapped);
+		if (fd >= 0) close(fd);
+		a = NULL;
+		length = 0;
+		base = NULL;
+		header = header0;
+		mapped = 0;
+		fd = f;
+
+		try {
+			resize((size_t)st.st_size > header ? (st.st_size - header) / sizeof(T) : 0);
+		} catch (std::bad_alloc&) {
+			return false;
+		}
+		return true;
+	}
+
+	// Indexing - override [] operator
+	T& operator[](long i) {
+		assert(i >= 0 && i < length);
+		return a[i];
+	}
+
+	// === GROWING / SHRINKING ===
+
+	// Change the length to len elements, keeping the elements below both
+	// lengths. Throws std::bad_alloc, like new, if the mapping cannot be
+	// changed.
+	void resize(long len) {
+		size_t page = sysconf(_SC_PAGESIZE);
+		size_t bytes = (header + len * sizeof(T) + page - 1) / page * page;
+
+		size_t old = mapped;
+
+		// A file must be long enough before pages past its old end are mapped
+		if (fd >= 0 && bytes > old && ftruncate(fd, bytes) != 0) throw std::bad_alloc();
+
+		if (bytes != old) {
+			void* m = NULL;
+
+			if (bytes == 0) {
+				munmap(base, mapped);
+			} else if (mapped == 0) {
+				m = fd >= 0 ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+				            : mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+				                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			} else {
+				m = mremap(base, mapped, bytes, MREMAP_MAYMOVE);
+			}
+
+			if (m == MAP_FAILED) throw std::bad_alloc();
+
+			base = (char*)m;
+			a = base != NULL ? (T*)(base + header) : NULL;
+			mapped = bytes;
+			if (base != NULL && advice != MADV_NORMAL) madvise(base, mapped, advice);
+		}
+
+		// Release file blocks past the new end only once they are unmapped
+		if (fd >= 0 && bytes < old && ftruncate(fd, bytes) != 0) throw std::bad_alloc();
+
+		length = len;
+	}
+
+	// === ACCESS HINTS ===
+
+	// Tell the kernel how the array will be read: MADV_SEQUENTIAL reads ahead
+	// aggressively and drops pages behind, MADV_RANDOM turns read-ahead off,
+	// MADV_NORMAL restores the default
+	void advise(int advice0) {
+		advice = advice0;
+		if (base != NULL) madvise(base, mapped, advice);
+	}
+
+	// Write changed pages of a file-backed array, header included, to disk
+	bool sync() {
+		return base == NULL || msync(base, mapped, MS_SYNC) == 0;
+	}
+};
+
+#endif // MAPPED_ARRAY_HPP
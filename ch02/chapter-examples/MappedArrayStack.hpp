@@ -0,0 +1,255 @@
+#ifndef MAPPED_ARRAY_STACK_HPP
+#define MAPPED_ARRAY_STACK_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayStack.hpp"
+#include "MappedArray.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Implements the List interface like FastArrayStack, but on a MappedArray, so
+// the backing array can be a file larger than RAM. Growing remaps instead of
+// allocating and copying, and sizes are longs so billions of elements fit.
+//
+// A file starts with a MappedArrayStackHeader that holds n. The file also
+// holds the spare capacity past n, so its length alone would count zeroed
+// elements that were never added whenever the stack is not closed cleanly.
+template <typename T>
+class MappedArrayStack {
+public:
+	// The start of a file. It is mapped along with the elements, so the
+	// count is written to the file with them, and sync() makes both durable.
+	struct Header {
+		char magic[8];
+		long n;
+		char reserved[48];
+	};
+
+	static_assert(sizeof(Header) == 64, "the header keeps the elements 64-byte aligned");
+
+	static constexpr char magic[8] = { 'O', 'D', 'S', 'M', 'A', 'P', 'S', 0 };
+
+	MappedArray<T> a;
+	long n;
+
+	// Elements live in anonymous memory
+	MappedArrayStack() : n(0) {}
+
+	// Elements live in the file at path. The elements a stack left in the
+	// file become this one's contents, and the file keeps them when the stack
+	// is destroyed. Throws std::runtime_error if the file cannot be opened or
+	// mapped, rather than quietly keeping the elements in memory, or if it
+	// holds something other than a stack.
+	MappedArrayStack(const char* path) : n(0) {
+		if (!a.open(path, sizeof(Header))) {
+			throw std::runtime_error(std::string("MappedArrayStack cannot open ") + path + ": " + strerror(errno));
+		}
+
+		Header* h = header();
+		if (a.length == 0 && h->n == 0 && std::all_of(h->magic, h->magic + 8, [](char c) { return c == 0; })) {
+			// A new file
+			memcpy(h->magic, magic, sizeof(magic));
+		} else if (memcmp(h->magic, magic, sizeof(magic)) != 0 || h->n < 0 || h->n > a.length) {
+			throw std::runtime_error(std::string("MappedArrayStack: ") + path + " does not hold a stack");
+		}
+		n = h->n;
+	}
+
+	~MappedArrayStack() {
+		// Shrink to exactly n elements so a file holds nothing else. If the
+		// mapping cannot change, the file keeps the spare capacity instead.
+		try {
+			a.resize(n);
+		} catch (std::bad_alloc&) {}
+	}
+
+	long size() {
+		return n;
+	}
+
+	Header* header() {
+		return (Header*)a.base;
+	}
+
+	// Record n in a file's header
+	void saveSize() {
+		if (a.fd >= 0) header()->n = n;
+	}
+
+	// === BASICS ===
+
+	T get(long i) {
+		// Return the value at index i
+		return a[i];
+	}
+
+	T set(long i, T x) {
+		// Store the value of index i
+		T y = a[i];
+
+		// Set a[i] equal to x and return the old value
+		a[i] = x;
+		return y;
+	}
+
+	void add(long i, T x) {
+		// Check if a is already full. If so, resize so that a.length > n
+		if (n + 1 > a.length) resize();
+
+		// Shift elements a[i:n-1] right by one position
+		std::copy_backward(a.a + i, a.a + n, a.a + n + 1);
+
+		// Set a[i] equal to x and increment n
+		a[i] = x;
+		n++;
+		saveSize();
+	}
+
+	T remove(long i) {
+		// Store the value of index i
+		T x = a[i];
+
+		// Shift elements a[i+1:n-1] left by one position (overwriting a[i])
+		std::copy(a.a + i + 1, a.a + n, a.a + i);
+
+		// Decrement n
+		n--;
+		saveSize();
+
+		// Check if n is getting too small (less than 1/3 full)
+		if (a.length >= 3 * n) resize();
+
+		return x;
+	}
+
+	// Reverse the elements in place
+	void reverse() {
+		std::reverse(a.a, a.a + n);
+	}
+
+	// === GROWING / SHRINKING ===
+
+	void resize() {
+		// Remap to 2n elements. Nothing is copied: the pages stay where they
+		// are and only the mapping changes.
+		a.resize(std::max(2 * n, 1L));
+	}
+
+	// === ACCESS HINTS ===
+
+	// The elements will be scanned in order, e.g. appended and then replayed
+	void adviseSequential() {
+		a.advise(MADV_SEQUENTIAL);
+	}
+
+	// The elements will be read at scattered indices
+	void adviseRandom() {
+		a.advise(MADV_RANDOM);
+	}
+
+	// Write the elements and the count of a file-backed stack to disk
+	bool sync() {
+		return a.sync();
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "MappedArrayStack: An ArrayStack on a Memory-Mapped File" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, 1);
+		std::cout << "MappedArrayStack.add(index: 0, value: 1)" << std::endl;
+		this->add(1, 2);
+		std::cout << "MappedArrayStack.add(index: 1, value: 2)" << std::endl;
+		this->add(2, 3);
+		std::cout << "MappedArrayStack.add(index: 2, value: 3)" << std::endl;
+
+		this->printAllElements();
+
+		this->remove(0);
+		std::cout << "MappedArrayStack.remove(index: 0)" << std::endl;
+
+		this->printAllElements();
+
+		// Back a second stack with a file, close it and open it again
+		char path[] = "/tmp/MappedArrayStackXXXXXX";
+		int fd = mkstemp(path);
+		if (fd < 0) return;
+		close(fd);
+
+		{
+			MappedArrayStack<T> file(path);
+			file.adviseSequential();
+
+			for (int i = 0; i < 5; i++) {
+				file.add(file.size(), i * i);
+			}
+			std::cout << "MappedArrayStack(path).add(value: 0, 1, 4, 9, 16)" << std::endl;
+			file.printAllElements();
+		}
+
+		{
+			MappedArrayStack<T> reopened(path);
+			std::cout << "MappedArrayStack(path) reopened, size() = " << reopened.size() << std::endl;
+			reopened.printAllElements();
+		}
+
+		// A stack that is not closed cleanly leaves its spare capacity in the
+		// file as zeroed elements. The count in the header still says how
+		// many were added.
+		if (truncate(path, 4096) != 0) return;
+		MappedArrayStack<T> untrimmed(path);
+		std::cout << "MappedArrayStack(path) reopened with the file grown to 4096 bytes, size() = "
+		          << untrimmed.size() << std::endl;
+		untrimmed.printAllElements();
+
+		unlink(path);
+	}
+
+	// Append elements to an ArrayStack, which copies them into a new array
+	// on every resize, and to a MappedArrayStack, which remaps instead
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack vs MappedArrayStack: appending elements" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int count = 1 << 26;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		{
+			ArrayStack<T> heap;
+			for (int i = 0; i < count; i++) {
+				heap.add(heap.size(), i);
+			}
+		}
+		double heapSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		{
+			MappedArrayStack<T> mapped;
+			for (int i = 0; i < count; i++) {
+				mapped.add(mapped.size(), i);
+			}
+		}
+		double mappedSeconds = secondsSince(start);
+
+		std::cout << count << " appends: ArrayStack " << heapSeconds << " s, MappedArrayStack "
+		          << mappedSeconds << " s" << std::endl;
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+#endif // MAPPED_ARRAY_STACK_HPP
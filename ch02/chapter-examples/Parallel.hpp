@@ -0,0 +1,476 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "../../common/ThreadPool.hpp"
+#include "ArrayDeque.hpp"
+#include "ArrayStack.hpp"
+#include "RootishArrayStack.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+// The elements of a container as a list of contiguous pieces of memory, in
+// storage order: one for an ArrayStack, up to two for an ArrayDeque and one
+// per block for a RootishArrayStack. When reversed is set, list index i is
+// element n-1-i of the pieces, as in a reversed ArrayDeque.
+template <typename T>
+class Segments {
+public:
+	std::vector<T*> parts;
+	std::vector<long> starts;   // index of each part's first element
+	std::vector<long> lengths;
+	long n;
+	bool reversed;
+
+	Segments() : n(0), reversed(false) {}
+
+	void add(T* p, long len) {
+		if (len <= 0) return;
+
+		parts.push_back(p);
+		starts.push_back(n);
+		lengths.push_back(len);
+		n += len;
+	}
+
+	// Call fn(p, len, offset) on each contiguous piece of list elements
+	// [begin, end), where p[0 ... len-1] are the list elements from offset
+	// on. p is a T*, or a std::reverse_iterator<T*> that walks a piece
+	// backwards when the segments are reversed.
+	template <typename Fn>
+	void forRange(long begin, long end, Fn fn) {
+		if (reversed) {
+			int s = std::upper_bound(starts.begin(), starts.end(), n - 1 - begin) - starts.begin() - 1;
+
+			for (; begin < end; s--) {
+				long from = n - 1 - begin - starts[s];
+				long len = std::min(from + 1, end - begin);
+
+				fn(std::reverse_iterator<T*>(parts[s] + from + 1), len, begin);
+				begin += len;
+			}
+			return;
+		}
+
+		int s = std::upper_bound(starts.begin(), starts.end(), begin) - starts.begin() - 1;
+
+		for (; begin < end; s++) {
+			long from = begin - starts[s];
+			long len = std::min(lengths[s] - from, end - begin);
+
+			fn(parts[s] + from, len, begin);
+			begin += len;
+		}
+	}
+};
+
+template <typename T, typename Alloc>
+Segments<T> segmentsOf(ArrayStack<T, Alloc>& s) {
+	Segments<T> segments;
+	segments.add(s.a.a, s.n);
+	return segments;
+}
+
+// A reversed deque is read through reversed segments, so it stays as it is
+template <typename T, typename Alloc>
+Segments<T> segmentsOf(ArrayDeque<T, Alloc>& d) {
+	Segments<T> segments;
+	int first = d.firstSegment();
+	segments.add(d.a.a + d.j, first);
+	segments.add(d.a.a, d.n - first);
+	segments.reversed = d.reversed;
+	return segments;
+}
+
+template <typename T>
+Segments<T> segmentsOf(RootishArrayStack<T>& r) {
+	Segments<T> segments;
+
+	for (int b = 0; b < r.blocks.size() && b*(b + 1)/2 < r.n; b++) {
+		segments.add(r.blocks.get(b), std::min(b + 1, r.n - b*(b + 1)/2));
+	}
+	return segments;
+}
+
+// Parallel algorithms over the array containers, run on a ThreadPool. Work
+// is split into chunks of list indices; a chunk covering several segments
+// works on each piece of contiguous memory in turn.
+class Parallel {
+public:
+	// Chunks smaller than this are not worth handing to another thread
+	static const long minChunk = 1 << 14;
+
+	// Split n elements into chunks: a few per thread, so a slow thread does
+	// not hold everyone up
+	static long chunksFor(long n, ThreadPool& pool) {
+		return std::max(1L, std::min(n / minChunk, 4L * pool.size()));
+	}
+
+	// === ALGORITHMS ===
+
+	// Call f(x) on every element
+	template <typename Container, typename F>
+	static void forEach(Container& c, F f, ThreadPool& pool = ThreadPool::shared()) {
+		auto segments = segmentsOf(c);
+		long n = segments.n;
+		long chunks = chunksFor(n, pool);
+
+		pool.run(chunks, [&](long k) {
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				std::for_each(p, p + len, f);
+			});
+		});
+	}
+
+	// Combine the elements in list order with an associative op
+	template <typename Container, typename T, typename Op>
+	static T reduce(Container& c, T init, Op op, ThreadPool& pool = ThreadPool::shared()) {
+		auto segments = segmentsOf(c);
+		long n = segments.n;
+		long chunks = chunksFor(n, pool);
+		std::vector<T> partial(chunks);
+		std::vector<char> empty(chunks, 1);
+
+		pool.run(chunks, [&](long k) {
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				T total = empty[k] ? p[0] : op(partial[k], p[0]);
+				partial[k] = std::accumulate(p + 1, p + len, total, op);
+				empty[k] = 0;
+			});
+		});
+
+		T total = init;
+		for (long k = 0; k < chunks; k++) {
+			if (!empty[k]) total = op(total, partial[k]);
+		}
+		return total;
+	}
+
+	// Replace each element by op of it and every element before it. Each
+	// chunk is reduced in a first pass; the second pass scans each chunk
+	// starting from the total of the chunks before it.
+	template <typename Container, typename Op>
+	static void inclusiveScan(Container& c, Op op, ThreadPool& pool = ThreadPool::shared()) {
+		auto segments = segmentsOf(c);
+		typedef typename std::remove_pointer<decltype(segments.parts.data())>::type Pointer;
+		typedef typename std::remove_pointer<Pointer>::type T;
+
+		long n = segments.n;
+		long chunks = chunksFor(n, pool);
+		std::vector<T> totals(chunks);
+
+		pool.run(chunks, [&](long k) {
+			bool first = true;
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				T total = first ? p[0] : op(totals[k], p[0]);
+				totals[k] = std::accumulate(p + 1, p + len, total, op);
+				first = false;
+			});
+		});
+
+		// totals[k] becomes the total of chunks 0 ... k
+		for (long k = 1; k < chunks; k++) {
+			totals[k] = op(totals[k - 1], totals[k]);
+		}
+
+		pool.run(chunks, [&](long k) {
+			bool carry = k > 0;
+			T running = carry ? totals[k - 1] : T();
+
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				for (long i = 0; i < len; i++) {
+					running = carry ? op(running, p[i]) : p[i];
+					p[i] = running;
+					carry = true;
+				}
+			});
+		});
+	}
+
+	// Sort the elements with comp; like std::sort, equal elements may change
+	// order. A single segment is sorted in place;
+	// several are gathered into one array first and scattered back after.
+	template <typename Container, typename Compare>
+	static void sort(Container& c, Compare comp, ThreadPool& pool = ThreadPool::shared()) {
+		auto segments = segmentsOf(c);
+		typedef typename std::remove_pointer<decltype(segments.parts.data())>::type Pointer;
+		typedef typename std::remove_pointer<Pointer>::type T;
+
+		// A single reversed segment is sorted the other way round in place
+		if (segments.parts.size() <= 1) {
+			if (segments.n == 0) return;
+
+			if (segments.reversed) {
+				sortContiguous(segments.parts[0], segments.n,
+				               [&](const T& x, const T& y) { return comp(y, x); }, pool);
+			} else {
+				sortContiguous(segments.parts[0], segments.n, comp, pool);
+			}
+			return;
+		}
+
+		std::vector<T> all(segments.n);
+		copySegments(segments, all.data(), true, pool);
+		sortContiguous(all.data(), segments.n, comp, pool);
+		copySegments(segments, all.data(), false, pool);
+	}
+
+	template <typename Container>
+	static void sort(Container& c, ThreadPool& pool = ThreadPool::shared()) {
+		sort(c, std::less<>(), pool);
+	}
+
+	// Move the elements for which pred holds to the front, keeping the
+	// order within both groups, and return how many there were
+	template <typename Container, typename Pred>
+	static long partition(Container& c, Pred pred, ThreadPool& pool = ThreadPool::shared()) {
+		auto segments = segmentsOf(c);
+		typedef typename std::remove_pointer<decltype(segments.parts.data())>::type Pointer;
+		typedef typename std::remove_pointer<Pointer>::type T;
+
+		long n = segments.n;
+		long chunks = chunksFor(n, pool);
+		std::vector<long> matches(chunks + 1);
+
+		// Count the matches in each chunk
+		pool.run(chunks, [&](long k) {
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				matches[k + 1] += std::count_if(p, p + len, pred);
+			});
+		});
+
+		// matches[k] becomes the number of matches before chunk k
+		for (long k = 0; k < chunks; k++) {
+			matches[k + 1] += matches[k];
+		}
+		long front = matches[chunks];
+
+		// Each chunk writes its matches and the rest straight to their places
+		std::vector<T> out(n);
+		pool.run(chunks, [&](long k) {
+			long yes = matches[k];
+			long no = front + n * k / chunks - matches[k];
+
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long) {
+				for (long i = 0; i < len; i++) {
+					if (pred(p[i])) out[yes++] = p[i];
+					else out[no++] = p[i];
+				}
+			});
+		});
+
+		copySegments(segments, out.data(), false, pool);
+		return front;
+	}
+
+	// === HELPERS ===
+
+	// Copy the elements into all (gather) or back out of it
+	template <typename T>
+	static void copySegments(Segments<T>& segments, T* all, bool gather, ThreadPool& pool) {
+		long n = segments.n;
+		long chunks = chunksFor(n, pool);
+
+		pool.run(chunks, [&](long k) {
+			segments.forRange(n * k / chunks, n * (k + 1) / chunks, [&](auto p, long len, long offset) {
+				if (gather) std::copy(p, p + len, all + offset);
+				else std::copy(all + offset, all + offset + len, p);
+			});
+		});
+	}
+
+	// Sort runs in parallel, then merge pairs of runs until one is left. Each
+	// merge is split into pieces of equal output length, so the last merges
+	// still use every thread.
+	template <typename T, typename Compare>
+	static void sortContiguous(T* p, long n, Compare comp, ThreadPool& pool) {
+		long runs = 1;
+		while (runs < pool.size() && n / (2 * runs) >= minChunk) runs *= 2;
+
+		if (runs == 1) {
+			std::sort(p, p + n, comp);
+			return;
+		}
+
+		pool.run(runs, [&](long k) {
+			std::sort(p + n * k / runs, p + n * (k + 1) / runs, comp);
+		});
+
+		std::vector<T> buffer(n);
+		T* from = p;
+		T* to = buffer.data();
+
+		for (long width = 1; width < runs; width *= 2) {
+			long pairs = runs / (2 * width);
+			long pieces = std::max(1L, 2L * pool.size() / pairs);
+
+			pool.run(pairs * pieces, [&](long t) {
+				long pair = t / pieces;
+				long piece = t % pieces;
+
+				long begin = n * (2 * pair * width) / runs;
+				long middle = n * ((2 * pair + 1) * width) / runs;
+				long end = n * ((2 * pair + 2) * width) / runs;
+
+				const T* a = from + begin;
+				const T* b = from + middle;
+				long na = middle - begin;
+				long nb = end - middle;
+
+				long k0 = (na + nb) * piece / pieces;
+				long k1 = (na + nb) * (piece + 1) / pieces;
+				long i0 = coRank(k0, a, na, b, nb, comp);
+				long i1 = coRank(k1, a, na, b, nb, comp);
+
+				std::merge(a + i0, a + i1, b + (k0 - i0), b + (k1 - i1), to + begin + k0, comp);
+			});
+
+			std::swap(from, to);
+		}
+
+		if (from != p) {
+			pool.run(runs, [&](long k) {
+				std::copy(from + n * k / runs, from + n * (k + 1) / runs, p + n * k / runs);
+			});
+		}
+	}
+
+	// Number of elements of a among the first k outputs of a stable merge of
+	// a and b (ties go to a)
+	template <typename T, typename Compare>
+	static long coRank(long k, const T* a, long na, const T* b, long nb, Compare comp) {
+		long lo = std::max(0L, k - nb);
+		long hi = std::min(k, na);
+
+		while (lo < hi) {
+			long i = lo + (hi - lo) / 2;
+			long j = k - i;
+
+			// b[j-1] would come out before a[i] only if it were smaller
+			if (j > 0 && i < na && !comp(b[j - 1], a[i])) lo = i + 1;
+			else hi = i;
+		}
+		return lo;
+	}
+
+	// === TESTING ===
+
+	static void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "Parallel: Algorithms over the Array Containers" << std::endl;
+		std::cout << "===" << std::endl;
+
+		ArrayStack<int> stack;
+		ArrayDeque<int> deque;
+		RootishArrayStack<int> rootish;
+		int values[] = { 5, 3, 9, 1, 7, 2, 8 };
+
+		for (int i = 0; i < 7; i++) {
+			stack.add(i, values[i]);
+			deque.add(0, values[i]);
+			rootish.add(i, values[i]);
+		}
+
+		forEach(stack, [](int& x) { x *= 10; });
+		std::cout << "Parallel::forEach(ArrayStack, x *= 10)" << std::endl;
+		stack.printAllElements();
+
+		std::cout << "Parallel::reduce(ArrayDeque, 0, +) = "
+		          << reduce(deque, 0, [](int x, int y) { return x + y; }) << std::endl;
+
+		inclusiveScan(rootish, [](int x, int y) { return x + y; });
+		std::cout << "Parallel::inclusiveScan(RootishArrayStack, +)" << std::endl;
+		rootish.printAllElements();
+
+		sort(deque);
+		std::cout << "Parallel::sort(ArrayDeque)" << std::endl;
+		deque.printAllElements();
+
+		deque.reverse();
+		inclusiveScan(deque, [](int x, int y) { return x + y; });
+		std::cout << "ArrayDeque.reverse(), Parallel::inclusiveScan(ArrayDeque, +)" << std::endl;
+		deque.printAllElements();
+
+		long evens = partition(stack, [](int x) { return x % 20 == 0; });
+		std::cout << "Parallel::partition(ArrayStack, x % 20 == 0) = " << evens << std::endl;
+		stack.printAllElements();
+	}
+
+	// Time each algorithm against its serial std:: version on count ints
+	static void benchmark(long count = 100000000) {
+		std::cout << "===" << std::endl;
+		std::cout << "Parallel algorithms vs serial on " << count << " elements, "
+		          << ThreadPool::shared().size() << " threads" << std::endl;
+		std::cout << "===" << std::endl;
+
+		ArrayStack<int> s;
+		Array<int> b(count);
+		s.a = b;
+		s.n = count;
+		int* p = s.a.a;
+
+		auto fill = [&]() {
+			for (long i = 0; i < count; i++) p[i] = (int)((i * 2654435761u) >> 8);
+		};
+
+		auto add = [](int x, int y) { return x + y; };
+		auto addLong = [](long x, long y) { return x + y; };
+		auto odd = [](int x) { return (x & 1) != 0; };
+
+		// The serial versions work on a copy, which the parallel result must
+		// match
+		std::vector<int> expected;
+		auto same = [&]() { return std::equal(expected.begin(), expected.end(), p); };
+
+		fill();
+		expected.assign(p, p + count);
+		time("for_each", [&]() { std::for_each(expected.begin(), expected.end(), [](int& x) { x ^= 1; }); },
+		     [&]() { forEach(s, [](int& x) { x ^= 1; }); }, same);
+
+		long serialSum = 0;
+		long parallelSum = 1;
+		time("reduce", [&]() { serialSum = std::accumulate(p, p + count, 0L, addLong); },
+		     [&]() { parallelSum = reduce(s, 0L, addLong); }, [&]() { return serialSum == parallelSum; });
+
+		fill();
+		expected.assign(p, p + count);
+		time("inclusive_scan", [&]() { std::partial_sum(expected.begin(), expected.end(), expected.begin(), add); },
+		     [&]() { inclusiveScan(s, add); }, same);
+
+		fill();
+		expected.assign(p, p + count);
+		time("sort", [&]() { std::sort(expected.begin(), expected.end()); }, [&]() { sort(s); }, same);
+
+		fill();
+		expected.assign(p, p + count);
+		time("partition", [&]() { std::stable_partition(expected.begin(), expected.end(), odd); },
+		     [&]() { partition(s, odd); }, same);
+
+		s.a.release();
+		std::cout << std::endl;
+	}
+
+	// Print how long serial and parallel take, and whether agree() holds
+	// after both
+	template <typename Serial, typename Par, typename Agree>
+	static void time(const char* name, Serial serial, Par parallel, Agree agree) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		serial();
+		double serialSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		parallel();
+		double parallelSeconds = secondsSince(start);
+
+		std::cout << name << ": serial " << serialSeconds << " s, parallel " << parallelSeconds
+		          << " s (" << serialSeconds / parallelSeconds << "x)" << mismatch(agree()) << std::endl;
+	}
+};
+
+#endif // PARALLEL_HPP
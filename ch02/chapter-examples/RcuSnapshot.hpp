@@ -0,0 +1,294 @@
+#ifndef RCU_SNAPSHOT_HPP
+#define RCU_SNAPSHOT_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayStack.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Read-copy-update for a read-mostly array container (an ArrayStack,
+// FastArrayStack or ArrayDeque). Readers see an immutable version of the
+// container and never lock or wait. A writer copies the current version,
+// changes the copy and swaps it in with one atomic exchange; readers already
+// inside the old version finish with it undisturbed.
+//
+// Old versions are reclaimed through epochs. A reader publishes the global
+// epoch in its slot before loading the current version, and clears the slot
+// when done. A writer retires the version it replaced with the epoch E it
+// read just after the swap. Any reader that could still hold that version
+// entered at an epoch of at most E, so the version is freed once no slot
+// holds an epoch of E or less.
+template <typename Container>
+class RcuSnapshot {
+public:
+	static const int maxReaders = 64;
+	static const long idle = -1;
+
+	// A reader's epoch, on a cache line of its own so readers never write to
+	// a line that another reader uses
+	struct alignas(64) Slot {
+		std::atomic<long> epoch;
+		std::atomic<bool> taken;
+
+		Slot() : epoch(idle), taken(false) {}
+	};
+
+	struct Retired {
+		Container* version;
+		long epoch;
+	};
+
+	std::atomic<Container*> current;
+	std::atomic<long> epoch;
+	Slot slots[maxReaders];
+
+	std::mutex writeLock;            // writers take turns
+	std::vector<Retired> retired;    // under writeLock
+
+	RcuSnapshot() : current(new Container()), epoch(0) {}
+
+	// Only once no reader or writer uses the snapshot any more
+	~RcuSnapshot() {
+		destroy(current.load());
+		for (size_t r = 0; r < retired.size(); r++) {
+			destroy(retired[r].version);
+		}
+	}
+
+	RcuSnapshot(const RcuSnapshot&) = delete;
+	RcuSnapshot& operator=(const RcuSnapshot&) = delete;
+
+	// === READING ===
+
+	// A thread's handle for reading: claims a slot for as long as it lives
+	class Reader {
+	public:
+		RcuSnapshot& rcu;
+		Slot* slot;
+
+		Reader(RcuSnapshot& rcu0) : rcu(rcu0), slot(NULL) {
+			for (int r = 0; r < maxReaders && slot == NULL; r++) {
+				bool expected = false;
+				if (rcu.slots[r].taken.compare_exchange_strong(expected, true)) slot = &rcu.slots[r];
+			}
+			if (slot == NULL) throw std::length_error("RcuSnapshot has no free reader slots");
+		}
+
+		~Reader() {
+			slot->taken.store(false, std::memory_order_release);
+		}
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		// Call f(version) on the current version and return what it returns.
+		// f must not change the version or keep a reference to it. Wait-free:
+		// two stores and two loads around f.
+		template <typename F>
+		auto read(F f) {
+			slot->epoch.store(rcu.epoch.load());
+			Container& version = *rcu.current.load();
+
+			// Clear the slot however f returns
+			struct Leave {
+				Slot* slot;
+				~Leave() { slot->epoch.store(idle, std::memory_order_release); }
+			} leave = { slot };
+
+			return f(version);
+		}
+	};
+
+	// === WRITING ===
+
+	// Call f(copy) on a copy of the current version, then publish the copy
+	template <typename F>
+	void update(F f) {
+		std::lock_guard<std::mutex> guard(writeLock);
+
+		Container* old = current.load();
+		Container* fresh = copyOf(*old);
+		f(*fresh);
+
+		// Publish, then move to the next epoch. Readers that entered before
+		// the increment may hold old.
+		current.exchange(fresh);
+		retired.push_back(Retired { old, epoch.fetch_add(1) });
+
+		reclaim();
+	}
+
+	// Free the retired versions no reader can still be using. Called with
+	// writeLock held.
+	void reclaim() {
+		long oldest = epoch.load();
+		for (int r = 0; r < maxReaders; r++) {
+			long e = slots[r].epoch.load();
+			if (e != idle && e < oldest) oldest = e;
+		}
+
+		size_t kept = 0;
+		for (size_t r = 0; r < retired.size(); r++) {
+			if (retired[r].epoch < oldest) destroy(retired[r].version);
+			else retired[kept++] = retired[r];
+		}
+		retired.resize(kept);
+	}
+
+	// Wait until every retired version is freed
+	void synchronize() {
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> guard(writeLock);
+				reclaim();
+				if (retired.empty()) return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	// === HELPERS ===
+
+	// A new container with the same elements, in order
+	static Container* copyOf(Container& c) {
+		Container* copy = new Container();
+		for (int i = 0; i < c.size(); i++) {
+			copy->add(copy->size(), c.get(i));
+		}
+		return copy;
+	}
+
+	// The containers do not free their backing array themselves
+	static void destroy(Container* c) {
+		c->a.release();
+		delete c;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "RcuSnapshot: Lock-Free Readers over Copy-on-Write Versions" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->update([](Container& c) {
+			for (int i = 1; i <= 3; i++) c.add(c.size(), i);
+		});
+		std::cout << "RcuSnapshot.update(add 1, 2, 3)" << std::endl;
+
+		Reader reader(*this);
+		reader.read([](Container& c) {
+			c.printAllElements();
+			return 0;
+		});
+
+		// A reader keeps seeing its version while a writer replaces it
+		reader.read([this](Container& c) {
+			this->update([](Container& next) { next.set(0, 10); });
+			std::cout << "RcuSnapshot.update(set index 0 to 10) during a read" << std::endl;
+			std::cout << "Reader still sees get(0) = " << c.get(0) << ", " << this->retired.size()
+			          << " version waiting to be freed" << std::endl;
+			return 0;
+		});
+
+		this->synchronize();
+		std::cout << "RcuSnapshot.synchronize(), " << this->retired.size() << " versions waiting" << std::endl;
+
+		reader.read([](Container& c) {
+			c.printAllElements();
+			return 0;
+		});
+	}
+
+	// Readers look up random elements of a 4096-element table while one
+	// writer replaces an element every millisecond, against an ArrayStack
+	// behind a shared_mutex
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "RcuSnapshot vs shared_mutex: random reads with a rare writer" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int tableSize = 4096;
+		const long readsPerThread = 1 << 22;
+
+		for (int readers = 1; readers <= 8; readers *= 2) {
+			double lockedSeconds = run(readers, readsPerThread, tableSize, false);
+			double rcuSeconds = run(readers, readsPerThread, tableSize, true);
+
+			std::cout << readers << " readers x " << readsPerThread << " reads: shared_mutex " << lockedSeconds
+			          << " s, RcuSnapshot " << rcuSeconds << " s" << std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	// Time the given number of reader threads doing reads lookups each, with
+	// or without RCU
+	static double run(int readers, long reads, int tableSize, bool rcu) {
+		RcuSnapshot<ArrayStack<long>> snapshot;
+		ArrayStack<long> table;
+		std::shared_mutex lock;
+
+		snapshot.update([&](ArrayStack<long>& c) {
+			for (int i = 0; i < tableSize; i++) c.add(i, i);
+		});
+		for (int i = 0; i < tableSize; i++) table.add(i, i);
+
+		std::atomic<bool> done(false);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::thread writer([&]() {
+			for (long k = 0; !done.load(); k++) {
+				if (rcu) {
+					snapshot.update([k, tableSize](ArrayStack<long>& c) { c.set(k % tableSize, k); });
+				} else {
+					std::unique_lock<std::shared_mutex> guard(lock);
+					table.set(k % tableSize, k);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		});
+
+		std::vector<std::thread> threads;
+		for (int r = 0; r < readers; r++) {
+			threads.emplace_back([&, r]() {
+				unsigned x = 12345 + r;
+				long sum = 0;
+
+				if (rcu) {
+					typename RcuSnapshot<ArrayStack<long>>::Reader reader(snapshot);
+					for (long k = 0; k < reads; k++) {
+						x = x * 1664525 + 1013904223;
+						sum += reader.read([x](ArrayStack<long>& c) { return c.get(x % c.size()); });
+					}
+				} else {
+					for (long k = 0; k < reads; k++) {
+						x = x * 1664525 + 1013904223;
+						std::shared_lock<std::shared_mutex> guard(lock);
+						sum += table.get(x % table.size());
+					}
+				}
+
+				// Keep the reads from being optimized away
+				if (sum == -1) std::cout << sum;
+			});
+		}
+		for (size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+		double seconds = secondsSince(start);
+
+		done.store(true);
+		writer.join();
+		table.a.release();
+		return seconds;
+	}
+};
+
+#endif // RCU_SNAPSHOT_HPP
@@ -1,12 +1,13 @@
 #ifndef ROOTISH_ARRAY_STACK_HPP
 #define ROOTISH_ARRAY_STACK_HPP
 
+#include "../../common/OutputWriter.hpp"
+#include "ArrayStack.hpp"
+#include "Snapshot.hpp"
 #include <iostream>
 #include <cmath>
-
-// Forward declaration of ArrayStack
-template <typename T>
-class ArrayStack;
+#include <cstdlib>
+#include <type_traits>
 
 // Addresses the problem of wasted space by storing n elements in O(sqrt(n))
 // arrays where at most O(sqrt(n)) array locations are unused at any time
@@ -110,6 +111,73 @@ public:
 		}
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements to a snapshot file (see Snapshot.hpp). The used part
+	// of each block is written in order, and the number of blocks is kept in
+	// the header so load() rebuilds the same block structure.
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		for (int b = 0; b < blocks.size() && b*(b + 1)/2 < n; b++) {
+			int used = std::min(b + 1, n - b*(b + 1)/2);
+			w.write(blocks.get(b), used * sizeof(T));
+		}
+
+		return w.finish(n, blocks.size());
+	}
+
+	// Replace the elements with those of a snapshot, reading each block's
+	// elements straight into a newly allocated block
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		// The blocks must hold every element, with no more than the one spare
+		// block shrink() leaves. This is checked in 64 bits before any block
+		// is allocated; a block count that passes is at most m + 2.
+		uint64_t m = r.header.count;
+		uint64_t count = r.header.blockCount;
+		if (count > m + 2 || count*(count + 1)/2 < m) return false;
+		if (count >= 2 && (count - 2)*(count - 1)/2 >= m) return false;
+
+		// Read into the saved number of new blocks, so the list is unchanged if
+		// the rest of the file turns out to be bad
+		ArrayStack<T*> loaded;
+		while ((uint64_t)loaded.size() < count) {
+			loaded.add(loaded.size(), new T[loaded.size() + 1]);
+		}
+
+		bool ok = true;
+		for (uint64_t b = 0; ok && b < count && b*(b + 1)/2 < m; b++) {
+			uint64_t used = std::min(b + 1, m - b*(b + 1)/2);
+			ok = r.read(loaded.get(b), used * sizeof(T));
+		}
+		ok = ok && r.finish();
+
+		// Free the blocks that are not kept
+		ArrayStack<T*>& unused = ok ? blocks : loaded;
+		while (unused.size() > 0) {
+			delete [] unused.remove(unused.size() - 1);
+		}
+
+		if (!ok) {
+			loaded.a.release();
+			return false;
+		}
+
+		// Take over the new blocks' array
+		blocks.a = loaded.a;
+		blocks.n = loaded.n;
+		n = m;
+		return true;
+	}
+
 	// === TESTING ===
 
 	void test() {
@@ -147,20 +215,28 @@ public:
 		std::cout << "RootishArrayStack.set(index: 1, value: 4)" << std::endl;
 
 		this->printAllElements();
+
+		// Save to a snapshot and load it into another stack, which gets the
+		// same number of blocks
+		char path[] = "/tmp/RootishArrayStackXXXXXX";
+		int fd = mkstemp(path);
+		if (fd < 0) return;
+		close(fd);
+
+		bool saved = this->save(path);
+		RootishArrayStack<T> loaded;
+		bool ok = loaded.load(path);
+		std::cout << "RootishArrayStack.save(path) = " << saved << ", load(path) = " << ok
+		          << ", blocks.size() = " << this->blocks.size() << " saved, " << loaded.blocks.size()
+		          << " loaded" << std::endl;
+
+		loaded.printAllElements();
+
+		unlink(path);
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
@@ -0,0 +1,222 @@
+#ifndef SMALL_ARRAY_STACK_HPP
+#define SMALL_ARRAY_STACK_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+// Implements the List interface like ArrayStack, but keeps up to N elements
+// in a buffer inside the object. The heap is only used once the stack
+// outgrows the buffer, and the elements move back in when it shrinks again,
+// so small stacks never allocate.
+template <typename T, int N = 16>
+class SmallArrayStack {
+public:
+	T buffer[N];
+	T *a;        // buffer, or a heap array after an overflow
+	int length;
+	int n;
+
+	SmallArrayStack() : a(buffer), length(N), n(0) {}
+
+	~SmallArrayStack() {
+		if (a != buffer) delete[] a;
+	}
+
+	// a may point into the object itself, so copying would need more than
+	// copying the members
+	SmallArrayStack(const SmallArrayStack&) = delete;
+	SmallArrayStack& operator=(const SmallArrayStack&) = delete;
+
+	int size() {
+		return n;
+	}
+
+	// True while the elements are stored in the inline buffer
+	bool isInline() {
+		return a == buffer;
+	}
+
+	// === BASICS ===
+
+	T get(int i) {
+		// Return the value at index i
+		assert(i >= 0 && i < n);
+		return a[i];
+	}
+
+	T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T y = a[i];
+
+		// Set a[i] equal to x and return the old value
+		a[i] = x;
+		return y;
+	}
+
+	void add(int i, T x) {
+		// Check if a is already full. If so, resize so that length > n
+		if (n + 1 > length) resize();
+
+		// Shift elements a[i:n-1] right by one position
+		std::copy_backward(a + i, a + n, a + n + 1);
+
+		// Set a[i] equal to x and increment n
+		a[i] = x;
+		n++;
+	}
+
+	T remove(int i) {
+		// Store the value of index i
+		T x = a[i];
+
+		// Shift elements a[i+1:n-1] left by one position (overwriting a[i])
+		std::copy(a + i + 1, a + n, a + i);
+
+		// Decrement n
+		n--;
+
+		// Check if a heap array is getting too small (less than 1/3 full). The
+		// inline buffer never shrinks.
+		if (!isInline() && length >= 3*n) resize();
+
+		return x;
+	}
+
+	// Reverse the elements in place
+	void reverse() {
+		std::reverse(a, a + n);
+	}
+
+	// === GROWING / SHRINKING ===
+
+	void resize() {
+		int len = std::max(2*n, 1);
+
+		// Move back into the buffer once the elements fit again
+		if (len <= N) {
+			if (!isInline()) {
+				std::copy(a, a + n, buffer);
+				delete[] a;
+				a = buffer;
+				length = N;
+			}
+			return;
+		}
+
+		// Otherwise move to a new heap array of size 2n
+		T *b = new T[len];
+		std::copy(a, a + n, b);
+
+		if (!isInline()) delete[] a;
+		a = b;
+		length = len;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "SmallArrayStack: An ArrayStack with Inline Storage" << std::endl;
+		std::cout << "===" << std::endl;
+
+		for (int i = 0; i < N; i++) {
+			this->add(i, i);
+		}
+		std::cout << "SmallArrayStack.add() x " << N << ", isInline() = " << this->isInline() << std::endl;
+		this->printAllElements();
+
+		this->add(N, N);
+		std::cout << "SmallArrayStack.add(index: " << N << ", value: " << N << "), isInline() = "
+		          << this->isInline() << std::endl;
+		this->printAllElements();
+
+		while (this->size() > 2) {
+			this->remove(0);
+		}
+		std::cout << "SmallArrayStack.remove(index: 0) until size() = 2, isInline() = "
+		          << this->isInline() << std::endl;
+		this->printAllElements();
+
+		this->reverse();
+		std::cout << "SmallArrayStack.reverse()" << std::endl;
+		this->printAllElements();
+	}
+
+	// Build and drop millions of short-lived stacks of 1 to N elements, with
+	// ArrayStack and with SmallArrayStack, counting heap allocations
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack vs SmallArrayStack: millions of small stacks" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int stacks = 1 << 22;
+		long checksum = 0;
+
+		CountedElement::allocations = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int s = 0; s < stacks; s++) {
+			ArrayStack<CountedElement> heap;
+			for (int i = 0; i <= s % N; i++) {
+				heap.add(i, CountedElement(i));
+			}
+			checksum += heap.get(heap.size() - 1).x;
+
+			// ArrayStack never frees its array
+			heap.a.release();
+		}
+
+		double heapSeconds = secondsSince(start);
+		long heapAllocations = CountedElement::allocations;
+
+		CountedElement::allocations = 0;
+		start = std::chrono::steady_clock::now();
+
+		for (int s = 0; s < stacks; s++) {
+			SmallArrayStack<CountedElement, N> small;
+			for (int i = 0; i <= s % N; i++) {
+				small.add(i, CountedElement(i));
+			}
+			checksum -= small.get(small.size() - 1).x;
+		}
+
+		double smallSeconds = secondsSince(start);
+		long smallAllocations = CountedElement::allocations;
+
+		std::cout << stacks << " stacks: ArrayStack " << heapAllocations << " allocations, "
+		          << heapSeconds << " s; SmallArrayStack " << smallAllocations << " allocations, "
+		          << smallSeconds << " s" << mismatch(checksum == 0) << std::endl;
+		std::cout << std::endl;
+	}
+
+	// An element whose arrays count their heap allocations
+	struct CountedElement {
+		static inline long allocations = 0;
+		int x;
+
+		CountedElement(int x0 = 0) : x(x0) {}
+
+		static void* operator new[](size_t bytes) {
+			allocations++;
+			return ::operator new[](bytes);
+		}
+
+		static void operator delete[](void* p) {
+			::operator delete[](p);
+		}
+	};
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+#endif // SMALL_ARRAY_STACK_HPP
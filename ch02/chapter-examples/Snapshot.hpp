@@ -0,0 +1,328 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "../../common/OutputWriter.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// On-disk snapshot of a container of trivially copyable elements:
+//
+//   [ 64-byte SnapshotHeader ][ count elements, in list order ]
+//
+// The elements start 64 bytes in, so a mapped snapshot keeps them aligned and
+// SnapshotView can use them in place.
+const char snapshotMagic[8] = { 'O', 'D', 'S', 'S', 'N', 'A', 'P', 0 };
+const uint32_t snapshotVersion = 1;
+
+// Set when the elements are stored in reverse list order (a reversed
+// ArrayDeque is saved without moving anything)
+const uint32_t snapshotReversed = 1;
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t elementSize;
+	uint64_t count;
+	uint64_t blockCount;  // RootishArrayStack blocks, 0 for other containers
+	uint64_t checksum;    // of the element bytes
+	uint32_t flags;
+	uint32_t reserved[5];
+};
+
+static_assert(sizeof(SnapshotHeader) == 64, "snapshot header must stay 64 bytes");
+
+// Most elements a snapshot may hold. The containers index with int and load
+// into arrays of up to twice the count, so anything larger is rejected
+// before it can decide how much memory is allocated.
+const uint64_t snapshotMaxCount = INT_MAX / 2;
+
+// True if a file of fileSize bytes holds exactly a header and count elements
+// of elementSize bytes. Divides instead of multiplying, so a corrupt count
+// cannot overflow into a match.
+inline bool snapshotSizeMatches(uint64_t fileSize, uint64_t count, uint32_t elementSize) {
+	return count <= snapshotMaxCount && elementSize > 0 &&
+	       fileSize >= sizeof(SnapshotHeader) &&
+	       (fileSize - sizeof(SnapshotHeader)) % elementSize == 0 &&
+	       (fileSize - sizeof(SnapshotHeader)) / elementSize == count;
+}
+
+// 64-bit FNV-1a over 8-byte words. Bytes are buffered until a word is full,
+// so the result does not depend on how the data is split between update()
+// calls.
+class SnapshotChecksum {
+public:
+	uint64_t h;
+	uint64_t word;
+	int wordBytes;
+
+	SnapshotChecksum() : h(0xcbf29ce484222325ULL), word(0), wordBytes(0) {}
+
+	void update(const void* data, size_t len) {
+		const unsigned char* p = (const unsigned char*)data;
+
+		// Finish a partial word left over from the last call
+		while (len > 0 && wordBytes != 0) {
+			addByte(*p++);
+			len--;
+		}
+
+		// Hash whole words
+		for (; len >= 8; p += 8, len -= 8) {
+			uint64_t w;
+			memcpy(&w, p, 8);
+			h = (h ^ w) * 0x100000001b3ULL;
+		}
+
+		while (len > 0) {
+			addByte(*p++);
+			len--;
+		}
+	}
+
+	void addByte(unsigned char b) {
+		word |= (uint64_t)b << (8 * wordBytes);
+
+		if (++wordBytes == 8) {
+			h = (h ^ word) * 0x100000001b3ULL;
+			word = 0;
+			wordBytes = 0;
+		}
+	}
+
+	uint64_t value() {
+		// Mix in any trailing bytes and their number
+		return wordBytes == 0 ? h : ((h ^ word) * 0x100000001b3ULL) ^ wordBytes;
+	}
+};
+
+// Writes a snapshot: a placeholder header, the element bytes through a large
+// buffer (big blocks go straight to writev), then the real header once the
+// count and checksum are known. It is all written to path.tmp, which finish()
+// syncs and renames over path, so a failed or interrupted save leaves the
+// previous snapshot at path whole.
+class SnapshotWriter {
+public:
+	int fd;
+	OutputWriter* out;
+	SnapshotHeader header;
+	SnapshotChecksum checksum;
+	std::string path;
+	std::string tmpPath;
+	bool renamed;
+
+	SnapshotWriter(const char* path0, uint32_t elementSize)
+		: out(NULL), path(path0), tmpPath(path + ".tmp"), renamed(false) {
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+		header.version = snapshotVersion;
+		header.elementSize = elementSize;
+
+		fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) return;
+
+		out = new OutputWriter(fd);
+		out->write((const char*)&header, sizeof(header));
+	}
+
+	~SnapshotWriter() {
+		delete out;
+		if (fd < 0) return;
+
+		close(fd);
+		if (!renamed) unlink(tmpPath.c_str());
+	}
+
+	bool isOpen() {
+		return fd >= 0;
+	}
+
+	void write(const void* data, size_t len) {
+		checksum.update(data, len);
+		out->write((const char*)data, len);
+	}
+
+	// Write the final header, sync the file to disk and rename it over path.
+	// Returns false if anything failed to reach disk.
+	bool finish(uint64_t count, uint64_t blockCount = 0, uint32_t flags = 0) {
+		if (fd < 0) return false;
+
+		bool flushed = out->flush();
+
+		header.count = count;
+		header.blockCount = blockCount;
+		header.flags = flags;
+		header.checksum = checksum.value();
+
+		struct stat st;
+		bool written = flushed && fstat(fd, &st) == 0 &&
+		               (uint64_t)st.st_size == sizeof(header) + count * header.elementSize &&
+		               pwrite(fd, &header, sizeof(header), 0) == sizeof(header) &&
+		               fsync(fd) == 0 && rename(tmpPath.c_str(), path.c_str()) == 0;
+		if (!written) return false;
+
+		// The rename is only on disk once the directory is synced too
+		renamed = true;
+		return syncDirectory();
+	}
+
+	bool syncDirectory() {
+		size_t slash = path.rfind('/');
+		std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+
+		int d = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+		if (d < 0) return false;
+
+		bool synced = fsync(d) == 0;
+		close(d);
+		return synced;
+	}
+};
+
+// Reads a snapshot into memory. The header is checked when the file is
+// opened; the checksum once every element has been read.
+class SnapshotReader {
+public:
+	int fd;
+	SnapshotHeader header;
+	SnapshotChecksum checksum;
+
+	SnapshotReader(const char* path, uint32_t elementSize) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		bool valid = fstat(fd, &st) == 0 &&
+		             readAll(fd, &header, sizeof(header)) &&
+		             memcmp(header.magic, snapshotMagic, sizeof(header.magic)) == 0 &&
+		             header.version == snapshotVersion &&
+		             header.elementSize == elementSize &&
+		             snapshotSizeMatches(st.st_size, header.count, elementSize);
+
+		if (!valid) {
+			close(fd);
+			fd = -1;
+		}
+	}
+
+	~SnapshotReader() {
+		if (fd >= 0) close(fd);
+	}
+
+	bool isOpen() {
+		return fd >= 0;
+	}
+
+	// Copy the next len bytes of elements into data with one read (more
+	// only if the kernel returns a short read)
+	bool read(void* data, size_t len) {
+		if (!readAll(fd, data, len)) return false;
+
+		checksum.update(data, len);
+		return true;
+	}
+
+	// True if the bytes read match the checksum in the header
+	bool finish() {
+		return checksum.value() == header.checksum;
+	}
+
+	static bool readAll(int fd, void* data, size_t len) {
+		char* p = (char*)data;
+
+		while (len > 0) {
+			ssize_t got = ::read(fd, p, len);
+
+			if (got < 0 && errno == EINTR) continue;
+			if (got <= 0) return false;
+
+			p += got;
+			len -= got;
+		}
+
+		return true;
+	}
+};
+
+// Maps a snapshot read-only and uses its elements in place, so even a
+// multi-gigabyte container is ready as soon as the header has been checked.
+// get(i) returns element i of the saved list, whatever container saved it.
+template <typename T>
+class SnapshotView {
+public:
+	const char* base;
+	size_t length;
+	const SnapshotHeader* header;
+	const T* data;
+	int n;
+
+	// Verifying the checksum reads every page, so it can be skipped for an
+	// instant start from a trusted file
+	SnapshotView(const char* path, bool verify = true)
+		: base(NULL), length(0), header(NULL), data(NULL), n(0) {
+		int fd = open(path, O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SnapshotHeader)) {
+			void* m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (m != MAP_FAILED) {
+				base = (const char*)m;
+				length = st.st_size;
+			}
+		}
+		close(fd);
+
+		if (base == NULL) return;
+
+		const SnapshotHeader* h = (const SnapshotHeader*)base;
+		bool valid = memcmp(h->magic, snapshotMagic, sizeof(h->magic)) == 0 &&
+		             h->version == snapshotVersion &&
+		             h->elementSize == sizeof(T) &&
+		             snapshotSizeMatches(length, h->count, sizeof(T));
+
+		if (valid && verify) {
+			SnapshotChecksum checksum;
+			checksum.update(base + sizeof(SnapshotHeader), h->count * sizeof(T));
+			valid = checksum.value() == h->checksum;
+		}
+
+		if (!valid) return;
+
+		header = h;
+		data = (const T*)(base + sizeof(SnapshotHeader));
+		n = h->count;
+	}
+
+	~SnapshotView() {
+		if (base != NULL) munmap((void*)base, length);
+	}
+
+	SnapshotView(const SnapshotView&) = delete;
+	SnapshotView& operator=(const SnapshotView&) = delete;
+
+	// False if the file was missing, malformed or failed its checksum
+	bool isOpen() {
+		return header != NULL;
+	}
+
+	int size() {
+		return n;
+	}
+
+	T get(int i) {
+		if (header->flags & snapshotReversed) i = n - 1 - i;
+		return data[i];
+	}
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,325 @@
+#ifndef SOA_ARRAY_STACK_HPP
+#define SOA_ARRAY_STACK_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "Array.hpp"
+#include "ArrayKernels.hpp"
+#include "ArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <tuple>
+#include <utility>
+
+// Implements the List interface for records of fields Ts..., like
+// ArrayStack<Record>, but stores each field in an Array of its own (a
+// structure of arrays). A record is read and written as a std::tuple. A scan
+// over one field then reads only that field's column, instead of pulling
+// every whole record through the cache.
+template <typename... Ts>
+class SoAArrayStack {
+public:
+	typedef std::tuple<Ts...> Record;
+
+	// Field K of a record
+	template <int K>
+	using Field = typename std::tuple_element<K, Record>::type;
+
+	// The elements of one column, for scanning a field with plain loops or
+	// standard algorithms
+	template <typename C>
+	struct Span {
+		C* a;
+		int n;
+
+		C& operator[](int i) {
+			assert(i >= 0 && i < n);
+			return a[i];
+		}
+
+		int size() {
+			return n;
+		}
+
+		C* begin() {
+			return a;
+		}
+
+		C* end() {
+			return a + n;
+		}
+	};
+
+	std::tuple<Array<Ts>...> columns;
+	int length;  // capacity of every column
+	int n;
+
+	SoAArrayStack() : columns(Array<Ts>(0)...), length(0), n(0) {}
+
+	~SoAArrayStack() {
+		std::apply([](auto&... c) { (c.release(), ...); }, columns);
+	}
+
+	// The columns would be shared by both copies
+	SoAArrayStack(const SoAArrayStack&) = delete;
+	SoAArrayStack& operator=(const SoAArrayStack&) = delete;
+
+	int size() {
+		return n;
+	}
+
+	// === BASICS ===
+
+	Record get(int i) {
+		// Gather field i of every column
+		assert(i >= 0 && i < n);
+		return getAt(i, std::index_sequence_for<Ts...>());
+	}
+
+	Record set(int i, const Record& x) {
+		// Store the record at index i
+		Record y = get(i);
+
+		// Set it to x and return the old record
+		setAt(i, x, std::index_sequence_for<Ts...>());
+		return y;
+	}
+
+	void add(int i, const Record& x) {
+		assert(i >= 0 && i <= n);
+
+		// Check if the columns are already full. If so, resize so that
+		// length > n
+		if (n + 1 > length) resize();
+
+		// Shift elements i ... n-1 of every column right by one position
+		std::apply([i, this](auto&... c) { (std::copy_backward(c.a + i, c.a + n, c.a + n + 1), ...); },
+		           columns);
+
+		// Set record i equal to x and increment n
+		setAt(i, x, std::index_sequence_for<Ts...>());
+		n++;
+	}
+
+	void add(int i, const Ts&... xs) {
+		add(i, Record(xs...));
+	}
+
+	Record remove(int i) {
+		// Store the record at index i so it can be returned later
+		Record x = get(i);
+
+		// Shift elements i+1 ... n-1 of every column left one position
+		std::apply([i, this](auto&... c) { (std::copy(c.a + i + 1, c.a + n, c.a + i), ...); }, columns);
+
+		// Decrement n
+		n--;
+
+		// Check if n is getting too small (less than 1/3 full)
+		if (length >= 3*n) resize();
+
+		return x;
+	}
+
+	// === COLUMNS ===
+
+	// Field K of record i alone, without touching the other columns
+	template <int K>
+	Field<K> get(int i) {
+		assert(i >= 0 && i < n);
+		return std::get<K>(columns).a[i];
+	}
+
+	template <int K>
+	Field<K> set(int i, Field<K> x) {
+		assert(i >= 0 && i < n);
+		Field<K>& slot = std::get<K>(columns).a[i];
+		Field<K> y = slot;
+		slot = x;
+		return y;
+	}
+
+	// The n values of field K, in list order. Valid until the next add or
+	// remove.
+	template <int K>
+	Span<Field<K>> column() {
+		return Span<Field<K>> { std::get<K>(columns).a, n };
+	}
+
+	// Searches and reductions over column K for an arithmetic field, a
+	// block of values at a time (see ArrayKernels.hpp)
+
+	// Index of the first record whose field K equals x, or -1
+	template <int K>
+	int indexOf(Field<K> x) {
+		return ArrayKernels<Field<K>>::indexOf(std::get<K>(columns).a, n, x);
+	}
+
+	template <int K>
+	int count(Field<K> x) {
+		return ArrayKernels<Field<K>>::count(std::get<K>(columns).a, n, x);
+	}
+
+	template <int K>
+	Field<K> sum() {
+		return ArrayKernels<Field<K>>::sum(std::get<K>(columns).a, n);
+	}
+
+	// The stack must not be empty
+	template <int K>
+	Field<K> min() {
+		return ArrayKernels<Field<K>>::min(std::get<K>(columns).a, n);
+	}
+
+	template <int K>
+	Field<K> max() {
+		return ArrayKernels<Field<K>>::max(std::get<K>(columns).a, n);
+	}
+
+	// === GROWING / SHRINKING ===
+
+	// Give every column a new array of size 2n, so all of them always hold
+	// the same number of records
+	void resize() {
+		length = std::max(2*n, 1);
+
+		std::apply([this](auto&... c) { (resizeColumn(c), ...); }, columns);
+	}
+
+	template <typename C>
+	void resizeColumn(Array<C>& c) {
+		// Create a new array and copy n elements of the column to it
+		Array<C> b(length);
+		std::copy(c.a, c.a + n, b.a);
+
+		// Set the column to the new array
+		c = b;
+	}
+
+	// === HELPERS ===
+
+	template <size_t... K>
+	Record getAt(int i, std::index_sequence<K...>) {
+		return Record(std::get<K>(columns).a[i]...);
+	}
+
+	template <size_t... K>
+	void setAt(int i, const Record& x, std::index_sequence<K...>) {
+		((std::get<K>(columns).a[i] = std::get<K>(x)), ...);
+	}
+
+	// === TESTING ===
+
+	// Exercise this stack with two-field records. The values are written as
+	// (int, double) pairs, so both fields must be constructible from those.
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "SoAArrayStack: An ArrayStack of Records Stored by Column" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, Record(1, 2.5));
+		std::cout << "SoAArrayStack.add(index: 0, value: (1, 2.5))" << std::endl;
+		this->add(1, Record(2, 0.5));
+		std::cout << "SoAArrayStack.add(index: 1, value: (2, 0.5))" << std::endl;
+		this->add(1, Record(3, 4.0));
+		std::cout << "SoAArrayStack.add(index: 1, value: (3, 4))" << std::endl;
+
+		this->printAllElements();
+
+		this->remove(0);
+		std::cout << "SoAArrayStack.remove(index: 0)" << std::endl;
+
+		this->printAllElements();
+
+		this->template set<1>(1, 1.5);
+		std::cout << "SoAArrayStack.set<1>(index: 1, value: 1.5)" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "SoAArrayStack.get<0>(index: 1) = " << this->template get<0>(1)
+		          << ", SoAArrayStack.sum<1>() = " << this->template sum<1>() << std::endl;
+		std::cout << std::endl;
+	}
+
+	// Sum one field of 4M records stored as structs in an ArrayStack, and as
+	// columns in a SoAArrayStack
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack of structs vs SoAArrayStack: sum one field" << std::endl;
+		std::cout << "===" << std::endl;
+
+		struct Order {
+			long id;
+			double price;
+			int quantity;
+			int flags;
+			long updated;
+		};
+
+		const int count = 1 << 22;
+		ArrayStack<Order> structs;
+		SoAArrayStack<long, double, int, int, long> soa;
+
+		for (int i = 0; i < count; i++) {
+			Order o = { i, (double)(i % 1000), i % 7, 0, (long)i * 3 };
+			structs.add(i, o);
+			soa.add(i, o.id, o.price, o.quantity, o.flags, o.updated);
+		}
+
+		// Several passes over the data, so the time is mostly memory traffic
+		const int passes = 8;
+		double expected = 0;
+		double result = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int p = 0; p < passes; p++) {
+			double total = 0;
+			for (int i = 0; i < structs.n; i++) {
+				total += structs.a.a[i].price;
+			}
+			expected += total;
+		}
+		double structSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		for (int p = 0; p < passes; p++) {
+			double total = 0;
+			for (double price : soa.template column<1>()) {
+				total += price;
+			}
+			result += total;
+		}
+		double columnSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		double kernelResult = 0;
+		for (int p = 0; p < passes; p++) {
+			kernelResult += soa.template sum<1>();
+		}
+		double kernelSeconds = secondsSince(start);
+
+		// Prices are whole numbers well below 2^53, so every order of
+		// addition gives the same sum
+		bool agree = result == expected && kernelResult == expected;
+
+		std::cout << passes << " sums of " << count << " prices (" << sizeof(Order) << "-byte records): "
+		          << "structs " << structSeconds << " s, column loop " << columnSeconds
+		          << " s, column kernel " << kernelSeconds << " s" << mismatch(agree) << std::endl;
+
+		structs.a.release();
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) {
+			const char* separator = "";
+			out << "(";
+			std::apply([&](const auto&... x) { ((out << separator << x, separator = ", "), ...); }, get(i));
+			out << ")";
+		});
+	}
+};
+
+#endif // SOA_ARRAY_STACK_HPP
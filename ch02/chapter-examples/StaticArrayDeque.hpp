@@ -0,0 +1,209 @@
+#ifndef STATIC_ARRAY_DEQUE_HPP
+#define STATIC_ARRAY_DEQUE_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayDeque.hpp"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+// Implements the List interface like ArrayDeque, on a circular array of
+// exactly N elements inside the object. N is a power of two, so wrapping an
+// index is a mask instead of a division. Nothing is ever allocated, and
+// everything is constexpr. add() returns false instead of growing when full.
+template <typename T, int N>
+class StaticArrayDeque {
+public:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+	static constexpr int mask = N - 1;
+
+	T a[N];
+	int j;
+	int n;
+
+	// When set, index i refers to element n-1-i, so the deque is reversed
+	// without moving anything
+	bool reversed;
+
+	constexpr StaticArrayDeque() : a{}, j(0), n(0), reversed(false) {}
+
+	constexpr int size() const {
+		return n;
+	}
+
+	constexpr int capacity() const {
+		return N;
+	}
+
+	// === BASICS ===
+
+	constexpr T get(int i) const {
+		assert(i >= 0 && i < n);
+		if (reversed) i = n - 1 - i;
+
+		// Return the value at index i
+		return a[(j+i) & mask];
+	}
+
+	constexpr T set(int i, T x) {
+		assert(i >= 0 && i < n);
+		if (reversed) i = n - 1 - i;
+
+		// Store the value of index i
+		T y = a[(j+i) & mask];
+
+		// Set it to x and return the old value
+		a[(j+i) & mask] = x;
+		return y;
+	}
+
+	constexpr bool add(int i, T x) {
+		assert(i >= 0 && i <= n);
+
+		// There is no growing, so a full deque refuses the element
+		if (n == N) return false;
+
+		// Adding before element i of the reversed deque adds after element
+		// n-1-i of the underlying one
+		if (reversed) i = n - i;
+
+		// If i is less than n/2, shift elements 0 ... i-1 to the left
+		if (i < n/2) {
+			j = (j-1) & mask;
+
+			for (int k = 0; k <= i - 1; k++) {
+				a[(j+k) & mask] = a[(j+k+1) & mask];
+			}
+		} else {
+			// Otherwise, shift elements i ... n-1 to the right
+			for (int k = n; k > i; k--) {
+				a[(j+k) & mask] = a[(j+k-1) & mask];
+			}
+		}
+
+		// Set a[(j+i) mod N] equal to x and increment n
+		a[(j+i) & mask] = x;
+		n++;
+		return true;
+	}
+
+	constexpr T remove(int i) {
+		assert(i >= 0 && i < n);
+		if (reversed) i = n - 1 - i;
+
+		// Store the value of index i so it can be returned later
+		T x = a[(j+i) & mask];
+
+		// If i is less than n/2, shift 0 ... i-1 to the right
+		if (i < n/2) {
+			for (int k = i; k > 0; k--) {
+				a[(j+k) & mask] = a[(j+k-1) & mask];
+			}
+			j = (j+1) & mask;
+		} else {
+			// Otherwise, shift i+1 ..., n-1 to the left
+			for (int k = i; k < n - 1; k++) {
+				a[(j+k) & mask] = a[(j+k+1) & mask];
+			}
+		}
+
+		n--;
+		return x;
+	}
+
+	// Reverse the deque in O(1) by swapping the meaning of front and back
+	constexpr void reverse() {
+		reversed = !reversed;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "StaticArrayDeque: A Fixed-Capacity ArrayDeque" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, 1);
+		std::cout << "StaticArrayDeque.add(index: 0, value: 1)" << std::endl;
+		this->add(0, 2);
+		std::cout << "StaticArrayDeque.add(index: 0, value: 2)" << std::endl;
+		this->add(2, 3);
+		std::cout << "StaticArrayDeque.add(index: 2, value: 3)" << std::endl;
+		this->add(1, 4);
+		std::cout << "StaticArrayDeque.add(index: 1, value: 4)" << std::endl;
+
+		this->printAllElements();
+
+		this->remove(0);
+		std::cout << "StaticArrayDeque.remove(index: 0)" << std::endl;
+
+		this->printAllElements();
+
+		this->reverse();
+		std::cout << "StaticArrayDeque.reverse()" << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Add at the back and remove from the front of a deque that stays below
+	// N elements, against ArrayDeque
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayDeque vs StaticArrayDeque: add at back, remove at front" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const long ops = 1 << 26;
+		const int depth = N / 2;
+		long checksum = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ArrayDeque<T> dynamic;
+		for (int i = 0; i < depth; i++) dynamic.add(dynamic.size(), i);
+		for (long i = 0; i < ops; i++) {
+			dynamic.add(dynamic.size(), i);
+			checksum += dynamic.remove(0);
+		}
+		double dynamicSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		StaticArrayDeque<T, N> fixed;
+		for (int i = 0; i < depth; i++) fixed.add(fixed.size(), i);
+		for (long i = 0; i < ops; i++) {
+			fixed.add(fixed.size(), i);
+			checksum -= fixed.remove(0);
+		}
+		double fixedSeconds = secondsSince(start);
+
+		std::cout << ops << " adds and removes: ArrayDeque " << dynamicSeconds
+		          << " s, StaticArrayDeque " << fixedSeconds << " s"
+		          << mismatch(checksum == 0) << std::endl;
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+// Checked by the compiler: add and remove at both ends and in the middle of
+// a wrapped deque in a constant expression
+constexpr int staticArrayDequeCheck() {
+	StaticArrayDeque<int, 4> d;
+	d.add(0, 1);
+	d.add(0, 2);
+	d.add(2, 3);
+	d.add(1, 4);
+	bool refused = !d.add(0, 5);
+	d.remove(0);
+	d.reverse();
+	d.add(0, 6);
+
+	// Now [6, 3, 1, 4]
+	return refused ? d.get(0) * 1000 + d.get(1) * 100 + d.get(2) * 10 + d.get(3) : -1;
+}
+
+static_assert(staticArrayDequeCheck() == 6314, "StaticArrayDeque must work in constant expressions");
+
+#endif // STATIC_ARRAY_DEQUE_HPP
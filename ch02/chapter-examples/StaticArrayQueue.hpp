@@ -0,0 +1,161 @@
+#ifndef STATIC_ARRAY_QUEUE_HPP
+#define STATIC_ARRAY_QUEUE_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayQueue.hpp"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+// Implements the FIFO Queue interface like ArrayQueue, on a circular array of
+// exactly N elements inside the object. N is a power of two, so wrapping an
+// index is a mask instead of a division. Nothing is ever allocated, and
+// everything is constexpr. add() returns false instead of growing when full.
+template <typename T, int N>
+class StaticArrayQueue {
+public:
+	static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+	static constexpr int mask = N - 1;
+
+	T a[N];
+	int j;
+	int n;
+
+	constexpr StaticArrayQueue() : a{}, j(0), n(0) {}
+
+	constexpr int size() const {
+		return n;
+	}
+
+	constexpr int capacity() const {
+		return N;
+	}
+
+	// === BASICS ===
+
+	constexpr T get(int i) const {
+		// Return the value at index i, counted from the front
+		assert(i >= 0 && i < n);
+		return a[(j+i) & mask];
+	}
+
+	constexpr T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T y = a[(j+i) & mask];
+
+		// Set it to x and return the old value
+		a[(j+i) & mask] = x;
+		return y;
+	}
+
+	constexpr bool add(T x) {
+		// There is no growing, so a full queue refuses the element
+		if (n == N) return false;
+
+		// Set a[(j+n) mod N] equal to x and increment n
+		a[(j+n) & mask] = x;
+		n++;
+		return true;
+	}
+
+	constexpr T remove() {
+		assert(n > 0);
+
+		// Store a[j] so it can be returned later
+		T x = a[j];
+
+		// Increment j (mod N) and decrement n
+		j = (j+1) & mask;
+		n--;
+		return x;
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "StaticArrayQueue: A Fixed-Capacity ArrayQueue" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(1);
+		std::cout << "StaticArrayQueue.add(value: 1)" << std::endl;
+		this->add(2);
+		std::cout << "StaticArrayQueue.add(value: 2)" << std::endl;
+		this->add(3);
+		std::cout << "StaticArrayQueue.add(value: 3)" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "StaticArrayQueue.remove() = " << this->remove() << std::endl;
+
+		this->printAllElements();
+
+		while (this->add(this->size() + 10)) {}
+		std::cout << "StaticArrayQueue.add() until full, size() = " << this->size()
+		          << ", capacity() = " << this->capacity() << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Stream elements through a queue that stays below N elements, against
+	// ArrayQueue
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayQueue vs StaticArrayQueue: add/remove" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const long ops = 1 << 26;
+		const int depth = N / 2;
+		long checksum = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ArrayQueue<T> dynamic;
+		for (int i = 0; i < depth; i++) dynamic.add(i);
+		for (long i = 0; i < ops; i++) {
+			dynamic.add(i);
+			checksum += dynamic.remove();
+		}
+		double dynamicSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		StaticArrayQueue<T, N> fixed;
+		for (int i = 0; i < depth; i++) fixed.add(i);
+		for (long i = 0; i < ops; i++) {
+			fixed.add(i);
+			checksum -= fixed.remove();
+		}
+		double fixedSeconds = secondsSince(start);
+
+		std::cout << ops << " adds and removes: ArrayQueue " << dynamicSeconds
+		          << " s, StaticArrayQueue " << fixedSeconds << " s"
+		          << mismatch(checksum == 0) << std::endl;
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+// Checked by the compiler: wrap a queue around its array in a constant
+// expression
+constexpr int staticArrayQueueCheck() {
+	StaticArrayQueue<int, 4> q;
+	int total = 0;
+
+	for (int i = 1; i <= 10; i++) {
+		q.add(i);
+		if (q.size() == 3) total = total * 10 + q.remove();
+	}
+
+	// 1..8 removed in order, 9 and 10 still queued
+	return q.size() == 2 && q.get(0) == 9 && !(q.add(0) && q.add(0) && q.add(0)) ? total : -1;
+}
+
+static_assert(staticArrayQueueCheck() == 12345678, "StaticArrayQueue must work in constant expressions");
+
+#endif // STATIC_ARRAY_QUEUE_HPP
@@ -0,0 +1,181 @@
+#ifndef STATIC_ARRAY_STACK_HPP
+#define STATIC_ARRAY_STACK_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayStack.hpp"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+// Implements the List interface like ArrayStack, with room for exactly N
+// elements inside the object. Nothing is ever allocated, so it can be used
+// where allocation is not allowed, and everything is constexpr, so it can be
+// filled at compile time. add() returns false instead of growing when full.
+template <typename T, int N>
+class StaticArrayStack {
+public:
+	static_assert(N > 0, "capacity must be positive");
+
+	T a[N];
+	int n;
+
+	constexpr StaticArrayStack() : a{}, n(0) {}
+
+	constexpr int size() const {
+		return n;
+	}
+
+	constexpr int capacity() const {
+		return N;
+	}
+
+	// === BASICS ===
+
+	constexpr T get(int i) const {
+		// Return the value at index i
+		assert(i >= 0 && i < n);
+		return a[i];
+	}
+
+	constexpr T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T y = a[i];
+
+		// Set a[i] equal to x and return the old value
+		a[i] = x;
+		return y;
+	}
+
+	constexpr bool add(int i, T x) {
+		assert(i >= 0 && i <= n);
+
+		// There is no growing, so a full stack refuses the element
+		if (n == N) return false;
+
+		// Shift elements a[i:n-1] right by one position
+		for (int j = n; j > i; j--) {
+			a[j] = a[j-1];
+		}
+
+		// Set a[i] equal to x and increment n
+		a[i] = x;
+		n++;
+		return true;
+	}
+
+	constexpr T remove(int i) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T x = a[i];
+
+		// Shift elements a[i+1:n-1] left one position (overwriting a[i])
+		for (int j = i; j < n-1; j++) {
+			a[j] = a[j+1];
+		}
+
+		// Decrement n
+		n--;
+		return x;
+	}
+
+	// Reverse the elements in place
+	constexpr void reverse() {
+		for (int i = 0, j = n - 1; i < j; i++, j--) {
+			T x = a[i];
+			a[i] = a[j];
+			a[j] = x;
+		}
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "StaticArrayStack: A Fixed-Capacity ArrayStack" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, 1);
+		std::cout << "StaticArrayStack.add(index: 0, value: 1)" << std::endl;
+		this->add(1, 2);
+		std::cout << "StaticArrayStack.add(index: 1, value: 2)" << std::endl;
+		this->add(2, 3);
+		std::cout << "StaticArrayStack.add(index: 2, value: 3)" << std::endl;
+
+		this->printAllElements();
+
+		this->remove(0);
+		std::cout << "StaticArrayStack.remove(index: 0)" << std::endl;
+
+		this->printAllElements();
+
+		while (this->add(this->size(), this->size())) {}
+		std::cout << "StaticArrayStack.add() until full, size() = " << this->size()
+		          << ", capacity() = " << this->capacity() << std::endl;
+
+		this->printAllElements();
+
+		this->reverse();
+		std::cout << "StaticArrayStack.reverse()" << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Push and pop at the end of a stack that stays below N elements, against
+	// ArrayStack
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack vs StaticArrayStack: push/pop" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int rounds = 1 << 16;
+		long checksum = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ArrayStack<T> dynamic;
+		for (int r = 0; r < rounds; r++) {
+			for (int i = 0; i < N; i++) dynamic.add(dynamic.size(), i);
+			for (int i = 0; i < N; i++) checksum += dynamic.remove(dynamic.size() - 1);
+		}
+		double dynamicSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		StaticArrayStack<T, N> fixed;
+		for (int r = 0; r < rounds; r++) {
+			for (int i = 0; i < N; i++) fixed.add(fixed.size(), i);
+			for (int i = 0; i < N; i++) checksum -= fixed.remove(fixed.size() - 1);
+		}
+		double fixedSeconds = secondsSince(start);
+
+		std::cout << (long)rounds * N << " pushes and pops: ArrayStack " << dynamicSeconds
+		          << " s, StaticArrayStack " << fixedSeconds << " s"
+		          << mismatch(checksum == 0) << std::endl;
+		std::cout << std::endl;
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+// Checked by the compiler: build a stack in a constant expression
+constexpr int staticArrayStackCheck() {
+	StaticArrayStack<int, 4> s;
+	s.add(0, 1);
+	s.add(1, 2);
+	s.add(0, 3);
+	s.add(3, 4);
+	bool refused = !s.add(0, 5);
+	s.remove(1);
+	s.reverse();
+
+	// Now [4, 2, 3]
+	return refused ? s.get(0) * 100 + s.get(1) * 10 + s.get(2) : -1;
+}
+
+static_assert(staticArrayStackCheck() == 423, "StaticArrayStack must work in constant expressions");
+
+#endif // STATIC_ARRAY_STACK_HPP
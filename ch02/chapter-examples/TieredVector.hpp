@@ -0,0 +1,305 @@
+#ifndef TIERED_VECTOR_HPP
+#define TIERED_VECTOR_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "ArrayDeque.hpp"
+#include "ArrayStack.hpp"
+#include "FastArrayStack.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+// Implements the List interface with a tiered vector: a list of blocks of
+// b = 2^shift elements each, where b is kept near sqrt(n). Each block is a
+// circular array like ArrayDeque's, and every block but the last is full, so
+// element i is at position i mod b of block i / b and get/set are O(1).
+//
+// add(i, x) shifts elements within block i / b only, then passes that
+// block's last element on to the front of the next block, and so on to the
+// end. Adding at the front of a circular block is O(1), so add and remove
+// take O(b + n/b) = O(sqrt(n)) instead of ArrayStack's O(n - i).
+template <typename T>
+class TieredVector {
+public:
+	// A circular block; element k is at a[(j+k) mod b]
+	struct Ring {
+		T* a;
+		int j;
+	};
+
+	static const int minShift = 4;
+
+	ArrayStack<Ring> blocks;
+	int shift;
+	int mask;     // b - 1
+	int n;
+
+	TieredVector() : shift(minShift), mask((1 << minShift) - 1), n(0) {}
+
+	~TieredVector() {
+		for (int k = 0; k < blocks.size(); k++) {
+			freeRing(blocks.a[k]);
+		}
+		blocks.a.release();
+	}
+
+	// The blocks are not copied with the list
+	TieredVector(const TieredVector&) = delete;
+	TieredVector& operator=(const TieredVector&) = delete;
+
+	int size() {
+		return n;
+	}
+
+	// Elements per block
+	int blockSize() {
+		return mask + 1;
+	}
+
+	// === BASICS ===
+
+	// Element k of ring r
+	T& at(Ring& r, int k) {
+		return r.a[(r.j + k) & mask];
+	}
+
+	T get(int i) {
+		// Return the value at index i, position i mod b of block i / b
+		assert(i >= 0 && i < n);
+		return at(blocks.a[i >> shift], i & mask);
+	}
+
+	T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		T& slot = at(blocks.a[i >> shift], i & mask);
+		T y = slot;
+
+		// Set it to x and return the old value
+		slot = x;
+		return y;
+	}
+
+	void add(int i, T x) {
+		assert(i >= 0 && i <= n);
+
+		// If every block is full, start a new one, first doubling b if the
+		// blocks are getting too many
+		if (n == blocks.size() << shift) {
+			if (blocks.size() >= 2 << shift) rebuild(shift + 1);
+			if (n == blocks.size() << shift) blocks.add(blocks.size(), newRing(mask + 1));
+		}
+
+		int k = i >> shift;
+		int last = blocks.size() - 1;
+
+		if (k == last) {
+			insert(blocks.a[k], n - (last << shift), i & mask, x);
+			n++;
+			return;
+		}
+
+		// Block k is full: take its last element off, then make room for x
+		Ring& r = blocks.a[k];
+		T carry = at(r, mask);
+		insert(r, mask, i & mask, x);
+
+		// Each later full block takes the carried element at its front and
+		// gives up its last one
+		for (int m = k + 1; m < last; m++) {
+			Ring& next = blocks.a[m];
+			T y = at(next, mask);
+			next.j = (next.j - 1) & mask;
+			next.a[next.j] = carry;
+			carry = y;
+		}
+
+		// The last block has room at its front
+		Ring& end = blocks.a[last];
+		end.j = (end.j - 1) & mask;
+		end.a[end.j] = carry;
+		n++;
+	}
+
+	T remove(int i) {
+		assert(i >= 0 && i < n);
+
+		int k = i >> shift;
+		int last = blocks.size() - 1;
+		int count = k == last ? n - (last << shift) : mask + 1;
+		T x = erase(blocks.a[k], count, i & mask);
+
+		// Each later block gives its first element to the back of the block
+		// before it
+		for (int m = k + 1; m <= last; m++) {
+			Ring& next = blocks.a[m];
+			at(blocks.a[m - 1], mask) = next.a[next.j];
+			next.j = (next.j + 1) & mask;
+		}
+		n--;
+
+		// Drop the last block once it is empty, and halve b once n is well
+		// below b^2
+		if (n == last << shift) freeRing(blocks.remove(last));
+		if (shift > minShift && n < (1 << (2*shift)) / 8) rebuild(shift - 1);
+
+		return x;
+	}
+
+	// === BLOCKS ===
+
+	// Put x at position k of a ring holding count < b elements, shifting the
+	// shorter side
+	void insert(Ring& r, int count, int k, T x) {
+		if (k < count/2) {
+			// Shift elements 0 ... k-1 one to the left
+			r.j = (r.j - 1) & mask;
+			for (int t = 0; t < k; t++) {
+				at(r, t) = at(r, t + 1);
+			}
+		} else {
+			// Shift elements k ... count-1 one to the right
+			for (int t = count; t > k; t--) {
+				at(r, t) = at(r, t - 1);
+			}
+		}
+		at(r, k) = x;
+	}
+
+	// Remove position k of a ring holding count elements, shifting the
+	// shorter side; the slot after the last element is left free
+	T erase(Ring& r, int count, int k) {
+		T x = at(r, k);
+
+		if (k < count/2) {
+			// Shift elements 0 ... k-1 one to the right
+			for (int t = k; t > 0; t--) {
+				at(r, t) = at(r, t - 1);
+			}
+			r.j = (r.j + 1) & mask;
+		} else {
+			// Shift elements k+1 ... count-1 one to the left
+			for (int t = k; t < count - 1; t++) {
+				at(r, t) = at(r, t + 1);
+			}
+		}
+		return x;
+	}
+
+	// === GROWING / SHRINKING ===
+
+	// Copy the elements into new blocks of 2^newShift elements
+	void rebuild(int newShift) {
+		int newMask = (1 << newShift) - 1;
+		ArrayStack<Ring> rebuilt;
+
+		for (int i = 0; i < n; i++) {
+			if ((i & newMask) == 0) rebuilt.add(rebuilt.size(), newRing(newMask + 1));
+			rebuilt.a[i >> newShift].a[i & newMask] = get(i);
+		}
+
+		for (int k = 0; k < blocks.size(); k++) {
+			freeRing(blocks.a[k]);
+		}
+		blocks.a = rebuilt.a;
+		blocks.n = rebuilt.n;
+		shift = newShift;
+		mask = newMask;
+	}
+
+	// A block of size elements, allocated the way an Array allocates its own
+	static Ring newRing(int size) {
+		return Ring { NewAllocator::allocate<T>(size), 0 };
+	}
+
+	// Free a block of the current size b
+	void freeRing(Ring r) {
+		NewAllocator::deallocate(r.a, mask + 1);
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "TieredVector: O(sqrt n) Adds and Removes with O(1) Access" << std::endl;
+		std::cout << "===" << std::endl;
+
+		for (int i = 0; i < 40; i++) {
+			this->add(i, i);
+		}
+		std::cout << "TieredVector.add(index: i, value: i) for i = 0 ... 39, "
+		          << this->blocks.size() << " blocks of " << this->blockSize() << std::endl;
+
+		this->add(5, 100);
+		std::cout << "TieredVector.add(index: 5, value: 100)" << std::endl;
+
+		std::cout << "TieredVector.remove(index: 20) = " << this->remove(20) << std::endl;
+
+		this->set(0, 200);
+		std::cout << "TieredVector.set(index: 0, value: 200)" << std::endl;
+		std::cout << "TieredVector.get(index: 16) = " << this->get(16) << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Adds and removes at random positions in a list of 1M elements, against
+	// FastArrayStack and ArrayDeque
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "FastArrayStack vs ArrayDeque vs TieredVector: random adds and removes" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int initial = 1 << 20;
+		const int ops = 1 << 12;
+
+		FastArrayStack<T> fast;
+		ArrayDeque<T> deque;
+		TieredVector<T> tiered;
+
+		for (int i = 0; i < initial; i++) {
+			fast.add(i, (T)i);
+			deque.add(i, (T)i);
+			tiered.add(i, (T)i);
+		}
+
+		double fastSeconds = edit(fast, ops);
+		double dequeSeconds = edit(deque, ops);
+		double tieredSeconds = edit(tiered, ops);
+
+		bool agree = fast.size() == tiered.size() && deque.size() == tiered.size();
+		for (int i = 0; agree && i < tiered.size(); i++) {
+			agree = fast.get(i) == tiered.get(i) && deque.get(i) == tiered.get(i);
+		}
+
+		std::cout << ops << " adds/removes on " << initial << " elements: FastArrayStack " << fastSeconds
+		          << " s, ArrayDeque " << dequeSeconds << " s, TieredVector " << tieredSeconds << " s"
+		          << mismatch(agree) << std::endl;
+
+		fast.a.release();
+		deque.a.release();
+		std::cout << std::endl;
+	}
+
+	// Run the same random edits on any list and time them
+	template <typename List>
+	static double edit(List& list, int ops) {
+		std::mt19937 rng(11);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int k = 0; k < ops; k++) {
+			if (k % 2 == 0) list.add(rng() % (list.size() + 1), (T)k);
+			else list.remove(rng() % list.size());
+		}
+		return secondsSince(start);
+	}
+
+	void printAllElements() {
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
+	}
+};
+
+#endif // TIERED_VECTOR_HPP
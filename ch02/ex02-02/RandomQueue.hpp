@@ -1,22 +1,31 @@
 #ifndef RANDOM_QUEUE_HPP
 #define RANDOM_QUEUE_HPP
 
+#include "../../common/OutputWriter.hpp"
 #include "../chapter-examples/Array.hpp"
-#include <cstdlib>
-#include <ctime>
+#include "Xoshiro256.hpp"
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
 
-// Implements FIFO Queue interface with a ciruclar array using modular arithmetic
-// https://en.cppreference.com/w/cpp/numeric/random/srand
-// https://en.cppreference.com/w/cpp/numeric/random/rand
+// Implements a Queue whose remove() returns a uniformly random element. The
+// elements are kept unordered in a[0..n-1], so removing one just moves the
+// last element into its place - O(1) instead of shifting.
 template <typename T>
 class RandomQueue {
 public:
 	Array<T> a;
-	int j;
 	int n;
+	Xoshiro256 rng;
 
-	RandomQueue() : a(n = 0) {}
+	// Seeded from std::random_device unless a seed is given, for
+	// reproducible runs
+	RandomQueue() : a(n = 0), rng(std::random_device()()) {}
+
+	RandomQueue(uint64_t seed) : a(n = 0), rng(seed) {}
 
 	int size() {
 		return n;
@@ -35,46 +44,65 @@ public:
 	bool add(T x) {
 		if (n+1 > a.length) resize();
 
-		a[(j+n)%a.length] = x;
+		a[n] = x;
 		n++;
 
 		return true;
 	}
 
 	T remove() {
-		// Seed the RNG with the current time
-		std::srand(std::time(0));
+		assert(n > 0);
 
-		// Generate random number
-		int randomIdx = std::rand() % this->size();
+		// Pick a uniformly random index
+		int i = rng.below(n);
 
-		std::cout << "Removing at index " << randomIdx << ": " << std::endl;
+		// Store current value at random index and fill the hole with the
+		// last element
+		T x = a[i];
+		a[i] = a[n-1];
+		n--;
 
-		// Store current value at random index
-		T x = a[randomIdx];
+		if (a.length >= 3*n) resize();
 
-		// Shift elements a[i+1:n-1] left one position (overwriting a[i])
-		for (int j = randomIdx; j < n-1; j++) {
-			a[j] = a[j+1];
+		return x;
+	}
+
+	// === BATCH OPERATIONS ===
+
+	// Return k distinct random elements without removing them. A partial
+	// Fisher-Yates shuffle moves the sample to the front of a, which is fine
+	// since the queue has no order.
+	std::vector<T> sample(int k) {
+		std::vector<T> result;
+		k = std::min(k, n);
+
+		for (int i = 0; i < k; i++) {
+			std::swap(a[i], a[i + rng.below(n - i)]);
+			result.push_back(a[i]);
 		}
 
-		// j = randomIdx % a.length;
-		n--;
+		return result;
+	}
 
-		if (a.length >= 3*n) resize();
+	// Remove every element, returned in uniformly random order
+	std::vector<T> drainShuffled() {
+		std::vector<T> result(a.a, a.a + n);
+		std::shuffle(result.begin(), result.end(), rng);
 
-		return x;
+		n = 0;
+		resize();
+
+		return result;
 	}
 
 	void resize() {
 		Array<T> b(std::max(2*n, 1));
 
 		for (int k = 0; k < n; k++) {
-			b[k] = a[(j+k)%a.length];
+			b[k] = a[k];
 		}
 
 		a = b;
-		j = 0;
 	}
 
 	// === TESTING ===
@@ -94,26 +122,25 @@ public:
 		this->add(5);
 		this->printAllElements();
 
-		this->remove();
+		std::cout << "RandomQueue.remove() = " << this->remove() << std::endl;
 		this->printAllElements();
-		this->remove();
+		std::cout << "RandomQueue.remove() = " << this->remove() << std::endl;
 		this->printAllElements();
-		this->remove();
+		std::cout << "RandomQueue.remove() = " << this->remove() << std::endl;
+		this->printAllElements();
+
+		std::vector<T> picked = this->sample(2);
+		std::cout << "RandomQueue.sample(k: 2) = [" << picked[0] << ", " << picked[1] << "]" << std::endl;
+		this->printAllElements();
+
+		std::vector<T> drained = this->drainShuffled();
+		std::cout << "RandomQueue.drainShuffled() = [" << drained[0] << ", " << drained[1]
+		          << ", " << drained[2] << "]" << std::endl;
 		this->printAllElements();
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
-
-		for (int i = 0; i < this->size(); i++) {
-			if (this->size() == 1 || i == this->size() - 1) {
-				std::cout << this->get(i);
-				continue;
-			}
-			std::cout << this->get(i) << ", ";
-		}
-		std::cout << "]" << std::endl;
-		std::cout << std::endl;
+		printElements(this->size(), [this](OutputWriter& out, long i) { out << this->get(i); });
 	}
 };
 
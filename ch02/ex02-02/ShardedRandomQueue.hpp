@@ -0,0 +1,286 @@
+#ifndef SHARDED_RANDOM_QUEUE_HPP
+#define SHARDED_RANDOM_QUEUE_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "RandomQueue.hpp"
+#include "Xoshiro256.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// A thread-safe RandomQueue that spreads its elements over per-thread shards,
+// each a RandomQueue behind its own lock. add() goes to the calling thread's
+// home shard, so threads adding at the same time rarely share a lock, unless
+// a randomly drawn shard holds fewer elements.
+//
+// remove() picks a shard by rejection sampling: it draws a shard uniformly
+// and keeps it with probability size / maxSize, and otherwise draws again. A
+// remove reads one shard's size per draw instead of every shard's, and needs
+// about shards * maxSize / n draws, close to one while the shards are
+// balanced.
+//
+// The result is exactly uniform only while the queue is quiescent: no other
+// thread is adding or removing, and maxSize is at least every shard's size.
+// Then a shard is kept with probability proportional to its size and a
+// uniformly random element is taken from it, so each of the n elements is
+// returned with probability exactly 1/n. Under concurrency no bound is
+// claimed. The size a remove reads can be stale by the operations in flight
+// on that shard, a shard that has outgrown maxSize is always kept until an
+// add raises it, and a shard emptied since it was drawn makes the remove
+// draw again. test() checks a concurrent drain with a chi-square test, which
+// finds no bias at its sample size, but that is not a guarantee.
+template <typename T>
+class ShardedRandomQueue {
+public:
+	// Each shard sits on its own cache lines so locking one does not slow
+	// down threads working on its neighbours
+	struct alignas(64) Shard {
+		std::mutex lock;
+		RandomQueue<T> q;
+		std::atomic<int> size;
+
+		Shard() : size(0) {}
+	};
+
+	Shard* shards;
+	int shardCount;
+
+	// At least the size of every shard, apart from adds in flight. Adds raise
+	// it; a remove that keeps rejecting shards scans them and lowers it.
+	alignas(64) std::atomic<int> maxSize;
+
+	ShardedRandomQueue(int shardCount0 = std::thread::hardware_concurrency(),
+	                   uint64_t seed = std::random_device()())
+		: shardCount(std::max(shardCount0, 1)), maxSize(0) {
+		shards = new Shard[shardCount];
+
+		for (int s = 0; s < shardCount; s++) {
+			shards[s].q.rng = Xoshiro256(seed + s);
+		}
+	}
+
+	~ShardedRandomQueue() {
+		delete[] shards;
+	}
+
+	int size() {
+		int n = 0;
+		for (int s = 0; s < shardCount; s++) {
+			n += shards[s].size.load(std::memory_order_relaxed);
+		}
+		return n;
+	}
+
+	// === PER-THREAD STATE ===
+
+	// Threads are numbered as they first use a queue; thread t's home shard
+	// is t % shardCount
+	static int threadId() {
+		static std::atomic<int> nextId(0);
+		thread_local int id = nextId.fetch_add(1);
+		return id;
+	}
+
+	// Each thread picks shards with its own generator
+	static Xoshiro256& threadRng() {
+		thread_local Xoshiro256 rng(std::random_device{}() ^ ((uint64_t)threadId() << 32));
+		return rng;
+	}
+
+	// === BASICS ===
+
+	bool add(T x) {
+		// Add to the home shard, unless a randomly drawn shard is smaller.
+		// Choosing the smaller of two keeps the shards close in size however
+		// the adds and removes are spread over the threads, which keeps
+		// remove() from drawing many times.
+		Shard* home = &shards[threadId() % shardCount];
+		Shard* other = &shards[threadRng().below(shardCount)];
+		Shard& shard = other->size.load(std::memory_order_relaxed) < home->size.load(std::memory_order_relaxed)
+		               ? *other : *home;
+		int m;
+		{
+			std::lock_guard<std::mutex> guard(shard.lock);
+			shard.q.add(x);
+			m = shard.q.size();
+			shard.size.store(m, std::memory_order_relaxed);
+		}
+
+		// Keep maxSize at least as large as this shard
+		int bound = maxSize.load(std::memory_order_relaxed);
+		while (m > bound && !maxSize.compare_exchange_weak(bound, m, std::memory_order_relaxed)) {}
+		return true;
+	}
+
+	// Remove a random element into x. Returns false if the queue is empty.
+	bool remove(T& x) {
+		Xoshiro256& rng = threadRng();
+
+		for (;;) {
+			// Expected draws are about shardCount * maxSize / n, so after a
+			// few times that many, maxSize is probably stale (or the queue
+			// empty)
+			for (int tries = 0; tries < 4 * shardCount; tries++) {
+				Shard& shard = shards[rng.below(shardCount)];
+				int m = shard.size.load(std::memory_order_relaxed);
+				int bound = maxSize.load(std::memory_order_relaxed);
+
+				// Keep the shard with probability m / bound
+				if (m == 0 || (m < bound && (int)rng.below(bound) >= m)) continue;
+
+				std::lock_guard<std::mutex> guard(shard.lock);
+				if (shard.q.size() > 0) {
+					x = shard.q.remove();
+					shard.size.store(shard.q.size(), std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			// Tighten maxSize to the largest shard, and stop if all are empty
+			if (tightenMaxSize() == 0) return false;
+		}
+	}
+
+	// Set maxSize to the size of the largest shard and return it
+	int tightenMaxSize() {
+		int largest = 0;
+		for (int s = 0; s < shardCount; s++) {
+			largest = std::max(largest, shards[s].size.load(std::memory_order_relaxed));
+		}
+		maxSize.store(largest, std::memory_order_relaxed);
+		return largest;
+	}
+
+	// === TESTING ===
+
+	// Fill the queue unevenly from several threads, then empty it from
+	// several threads at once, numbering the removes in the order they
+	// finish. Every element should be among the first half removed equally
+	// often, whichever shard it was on; a chi-square test checks that.
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "ShardedRandomQueue: A Concurrent RandomQueue" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int elements = 16;
+		const int threads = 4;
+		const int trials = 5000;
+		std::atomic<long> early[elements];
+		for (int e = 0; e < elements; e++) {
+			early[e] = 0;
+		}
+
+		for (int t = 0; t < trials; t++) {
+			// Thread 0 adds elements 0 ... 9 and the others two each
+			std::vector<std::thread> workers;
+			for (int w = 0; w < threads; w++) {
+				workers.emplace_back([this, w]() {
+					int first = w == 0 ? 0 : 10 + 2*(w - 1);
+					int last = w == 0 ? 10 : first + 2;
+					for (int e = first; e < last; e++) {
+						this->add(e);
+					}
+				});
+			}
+			for (int w = 0; w < threads; w++) {
+				workers[w].join();
+			}
+
+			std::atomic<int> removed(0);
+			workers.clear();
+			for (int w = 0; w < threads; w++) {
+				workers.emplace_back([this, &removed, &early]() {
+					T x;
+					while (this->remove(x)) {
+						if (removed.fetch_add(1) < elements / 2) early[(int)x]++;
+					}
+				});
+			}
+			for (int w = 0; w < threads; w++) {
+				workers[w].join();
+			}
+		}
+
+		double expected = (double)trials / 2;
+		double chiSquare = 0;
+		for (int e = 0; e < elements; e++) {
+			chiSquare += (early[e] - expected) * (early[e] - expected) / expected;
+		}
+
+		// 37.70 is the 0.001 critical value of chi-square with 15 degrees of
+		// freedom
+		std::cout << "ShardedRandomQueue.remove() from " << threads << " threads, " << trials << " trials of "
+		          << elements << " elements: chi-square = " << chiSquare
+		          << (chiSquare < 37.70 ? " (uniform)" : " (NOT uniform)") << std::endl;
+		std::cout << std::endl;
+	}
+
+	// Compare add/remove throughput against a single RandomQueue behind one
+	// mutex, from 1 to 64 threads, on queues that start with 64K elements
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ShardedRandomQueue vs mutex-wrapped RandomQueue (ops/s)" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const long totalOps = 1 << 22;
+		const int initial = 1 << 16;
+
+		for (int threads = 1; threads <= 64; threads *= 2) {
+			ShardedRandomQueue<T> sharded(threads);
+			RandomQueue<T> single;
+			std::mutex singleLock;
+
+			// Spread the initial elements evenly over the shards
+			run(threads, initial / threads, [&sharded](int i) {
+				sharded.add(i);
+			});
+			for (int i = 0; i < initial; i++) {
+				single.add(i);
+			}
+
+			double shardedRate = run(threads, totalOps / threads, [&sharded](int i) {
+				T x;
+				if (i % 2 == 0) sharded.add(i);
+				else sharded.remove(x);
+			});
+
+			double singleRate = run(threads, totalOps / threads, [&single, &singleLock](int i) {
+				std::lock_guard<std::mutex> guard(singleLock);
+				if (i % 2 == 0) single.add(i);
+				else if (single.size() > 0) single.remove();
+			});
+
+			std::cout << threads << " threads: sharded " << (long)shardedRate
+			          << ", mutex " << (long)singleRate << std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	// Run op(0..opsPerThread-1) on each of `threads` threads and return the
+	// total operations per second
+	template <typename Op>
+	static double run(int threads, long opsPerThread, Op op) {
+		std::vector<std::thread> workers;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int t = 0; t < threads; t++) {
+			workers.emplace_back([&op, opsPerThread]() {
+				for (long i = 0; i < opsPerThread; i++) {
+					op(i);
+				}
+			});
+		}
+		for (int t = 0; t < threads; t++) {
+			workers[t].join();
+		}
+
+		double seconds = secondsSince(start);
+		return threads * opsPerThread / seconds;
+	}
+};
+
+#endif // SHARDED_RANDOM_QUEUE_HPP
@@ -0,0 +1,80 @@
+#ifndef XOSHIRO256_HPP
+#define XOSHIRO256_HPP
+
+#include <cstdint>
+#include <limits>
+
+// xoshiro256** pseudo-random number generator (Blackman & Vigna)
+// https://prng.di.unimi.it/
+// Much faster than rand() and std::mt19937, with a 256-bit state. Satisfies
+// UniformRandomBitGenerator, so it also works with std::shuffle.
+class Xoshiro256 {
+public:
+	typedef uint64_t result_type;
+
+	uint64_t s[4];
+
+	// Expand the seed into the full state with splitmix64, as recommended by
+	// the authors, so that similar seeds still give unrelated streams
+	Xoshiro256(uint64_t seed) {
+		for (int i = 0; i < 4; i++) {
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			s[i] = z ^ (z >> 31);
+		}
+	}
+
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+
+	uint64_t next() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+
+		return result;
+	}
+
+	// Uniform integer in [0, bound) without modulo bias, using Lemire's
+	// multiply-and-reject method (rarely needs more than one draw)
+	uint64_t below(uint64_t bound) {
+		unsigned __int128 m = (unsigned __int128)next() * bound;
+		uint64_t low = (uint64_t)m;
+
+		if (low < bound) {
+			uint64_t threshold = -bound % bound;
+
+			while (low < threshold) {
+				m = (unsigned __int128)next() * bound;
+				low = (uint64_t)m;
+			}
+		}
+
+		return (uint64_t)(m >> 64);
+	}
+
+	// === UniformRandomBitGenerator ===
+
+	static constexpr uint64_t min() {
+		return 0;
+	}
+
+	static constexpr uint64_t max() {
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+	uint64_t operator()() {
+		return next();
+	}
+};
+
+#endif // XOSHIRO256_HPP
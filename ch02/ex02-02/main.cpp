@@ -1,8 +1,18 @@
 #include "RandomQueue.hpp"
+#include "ShardedRandomQueue.hpp"
+#include <cstring>
 
-int main() {
+int main(int argc, char* argv[]) {
 	RandomQueue<int> queue;
 	queue.test();
 
+	ShardedRandomQueue<int> sharded(4);
+	sharded.test();
+
+	// The benchmark takes several seconds, so it only runs when asked for
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		ShardedRandomQueue<int>::benchmark();
+	}
+
 	return 0;
 }
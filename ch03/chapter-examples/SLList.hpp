@@ -1,8 +1,12 @@
 #ifndef SL_LIST_HPP
 #define SL_LIST_HPP
 
+#include "../../common/OutputWriter.hpp"
+#include "../../ch02/chapter-examples/Snapshot.hpp"
 #include "Node.hpp"
+#include <cstdlib>
 #include <iostream>
+#include <type_traits>
 
 template <typename T>
 class SLList {
@@ -101,6 +105,62 @@ public:
 		return x;
 	}
 
+	// === SNAPSHOTS ===
+
+	// Save the elements, head to tail, to a snapshot file in the same format
+	// as the ch02 array containers (see Snapshot.hpp)
+	bool save(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotWriter w(path, sizeof(T));
+		if (!w.isOpen()) return false;
+
+		for (Node<T> *u = head; n > 0 && u != 0; u = u->next) {
+			w.write(&u->x, sizeof(T));
+		}
+
+		return w.finish(n);
+	}
+
+	// Replace the elements with those of a snapshot. Elements are read a
+	// chunk at a time and added at the tail.
+	bool load(const char* path) {
+		static_assert(std::is_trivially_copyable<T>::value, "snapshots need trivially copyable elements");
+
+		SnapshotReader r(path, sizeof(T));
+		if (!r.isOpen()) return false;
+
+		while (n > 0) {
+			remove();
+		}
+
+		const int chunk = 4096;
+		T* buffer = new T[chunk];
+		bool ok = true;
+
+		for (uint64_t left = r.header.count; ok && left > 0; ) {
+			int m = left < (uint64_t)chunk ? (int)left : chunk;
+			ok = r.read(buffer, m * sizeof(T));
+
+			for (int k = 0; ok && k < m; k++) {
+				add(buffer[k]);
+			}
+			left -= m;
+		}
+
+		delete[] buffer;
+
+		// Leave the list empty rather than half loaded
+		if (!ok || !r.finish()) {
+			while (n > 0) {
+				remove();
+			}
+			return false;
+		}
+
+		return true;
+	}
+
 	// === TESTING ===
 
 	void testStack() {
@@ -157,28 +217,45 @@ public:
 		this->remove();
 		std::cout << "SLList.remove()" << std::endl;
 		printAllElements();
+
+		this->add(4);
+		std::cout << "SLList.add(value: 4)" << std::endl;
+
+		// Save to a snapshot and load it into another list
+		char path[] = "/tmp/SLListXXXXXX";
+		int fd = mkstemp(path);
+		if (fd < 0) return;
+		close(fd);
+
+		bool saved = this->save(path);
+		SLList<T> loaded;
+		bool ok = loaded.load(path);
+		std::cout << "SLList.save(path) = " << saved << ", load(path) = " << ok << std::endl;
+		loaded.printAllElements();
+
+		unlink(path);
 	}
 
 	void printAllElements() {
-		std::cout << "\t> Contains Elements: [";
+		OutputWriter& out = stdoutWriter();
+		out << "\t> Contains Elements: [";
 
 		Node<T> *a = this->head;
 
 		while (a != 0) {
 			if (n == 1 || a->next == 0) {
-				std::cout << a->x;
+				out << a->x;
 				break;
 			} else {
-				std::cout << a->x << ", ";
+				out << a->x << ", ";
 				a = a->next;
 			}
 		}
-		std::cout << "]" << std::endl;
-
-		std::cout << "\t Head = " << this->head->x;
-		std::cout << " Tail = " << this->tail->x << std::endl;
+		out << "]\n";
 
-		std::cout << std::endl;
+		out << "\t Head = " << this->head->x;
+		out << " Tail = " << this->tail->x << "\n\n";
+		out.flush();
 	}
 };
 
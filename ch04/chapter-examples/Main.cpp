@@ -0,0 +1,14 @@
+#include "SkiplistList.hpp"
+#include <cstring>
+
+int main(int argc, char* argv[]) {
+	SkiplistList<int> list;
+	list.test();
+
+	// The benchmark takes a while, so it only runs when asked for
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+		SkiplistList<int>::benchmark();
+	}
+
+	return 0;
+}
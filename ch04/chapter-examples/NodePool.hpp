@@ -0,0 +1,77 @@
+#ifndef NODE_POOL_HPP
+#define NODE_POOL_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Hands out blocks of memory for list nodes, carved from 64 KiB chunks
+// instead of one new per node. Nodes come in a few sizes (one per skiplist
+// height), and each size has its own free list, so a freed node is reused by
+// the next node of the same size. Memory goes back to the system only when
+// the pool is destroyed.
+class NodePool {
+public:
+	static const int sizeClasses = 64;
+	static const size_t chunkBytes = 64 << 10;
+
+	// A free block holds the link to the next free block of its size
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	FreeBlock* free[sizeClasses];
+	std::vector<char*> chunks;
+	char* cursor;    // start of the unused part of the newest chunk
+	size_t left;     // bytes left in it
+
+	NodePool() : cursor(NULL), left(0) {
+		for (int c = 0; c < sizeClasses; c++) {
+			free[c] = NULL;
+		}
+	}
+
+	~NodePool() {
+		for (size_t k = 0; k < chunks.size(); k++) {
+			delete[] chunks[k];
+		}
+	}
+
+	NodePool(const NodePool&) = delete;
+	NodePool& operator=(const NodePool&) = delete;
+
+	// A block of the given bytes; every block of size class c must have the
+	// same size
+	void* allocate(int c, size_t bytes) {
+		assert(c >= 0 && c < sizeClasses);
+
+		if (free[c] != NULL) {
+			FreeBlock* b = free[c];
+			free[c] = b->next;
+			return b;
+		}
+
+		// Keep every block aligned for any type
+		bytes = (bytes + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+		if (bytes > left) {
+			size_t size = bytes > chunkBytes ? bytes : chunkBytes;
+			cursor = new char[size];
+			left = size;
+			chunks.push_back(cursor);
+		}
+
+		void* p = cursor;
+		cursor += bytes;
+		left -= bytes;
+		return p;
+	}
+
+	void deallocate(void* p, int c) {
+		FreeBlock* b = (FreeBlock*)p;
+		b->next = free[c];
+		free[c] = b;
+	}
+};
+
+#endif // NODE_POOL_HPP
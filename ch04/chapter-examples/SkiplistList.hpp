@@ -0,0 +1,303 @@
+#ifndef SKIPLIST_LIST_HPP
+#define SKIPLIST_LIST_HPP
+
+#include "../../common/Benchmark.hpp"
+#include "../../common/OutputWriter.hpp"
+#include "../../ch02/chapter-examples/ArrayStack.hpp"
+#include "../../ch02/chapter-examples/DualArrayDeque.hpp"
+#include "NodePool.hpp"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <random>
+
+// Implements the List interface with a skiplist. Each node of height h is on
+// lists 0 ... h; list 0 holds every element in order, and each higher list
+// skips over about half the nodes of the one below. Every pointer records
+// its length, the number of list-0 steps it jumps, so a search for index i
+// adds up lengths on the way down. get, set, add and remove take O(log n)
+// expected time.
+//
+// Nodes come from a NodePool, one size class per height.
+template <typename T>
+class SkiplistList {
+public:
+	struct Node;
+
+	// A forward pointer and the number of elements it jumps
+	struct Link {
+		Node* next;
+		int length;
+	};
+
+	// A node is followed in memory by its height+1 links
+	struct alignas(Link) Node {
+		T x;
+		int height;
+
+		Node(const T& x0, int h) : x(x0), height(h) {}
+
+		Link* links() {
+			return (Link*)(this + 1);
+		}
+	};
+
+	static const int maxHeight = 32;
+
+	NodePool pool;
+	Node* sentinel;
+	int h;   // height of the tallest node
+	int n;
+	std::mt19937 rng;
+
+	SkiplistList() : h(0), n(0), rng(1) {
+		sentinel = newNode(T(), maxHeight);
+	}
+
+	~SkiplistList() {
+		// The pool frees the memory; only the elements need destroying
+		for (Node* u = sentinel; u != NULL; ) {
+			Node* next = u->links()[0].next;
+			u->~Node();
+			u = next;
+		}
+	}
+
+	// Nodes belong to this list's pool
+	SkiplistList(const SkiplistList&) = delete;
+	SkiplistList& operator=(const SkiplistList&) = delete;
+
+	int size() {
+		return n;
+	}
+
+	// === BASICS ===
+
+	// The node before index i: the last one reached from the sentinel by
+	// links that do not pass i
+	Node* findPred(int i) {
+		Node* u = sentinel;
+		int j = -1;   // index of u
+
+		for (int r = h; r >= 0; r--) {
+			while (u->links()[r].next != NULL && j + u->links()[r].length < i) {
+				j += u->links()[r].length;
+				u = u->links()[r].next;
+			}
+		}
+		return u;
+	}
+
+	T get(int i) {
+		assert(i >= 0 && i < n);
+		return findPred(i)->links()[0].next->x;
+	}
+
+	T set(int i, T x) {
+		assert(i >= 0 && i < n);
+
+		// Store the value of index i
+		Node* u = findPred(i)->links()[0].next;
+		T y = u->x;
+
+		// Set it to x and return the old value
+		u->x = x;
+		return y;
+	}
+
+	void add(int i, T x) {
+		assert(i >= 0 && i <= n);
+
+		Node* w = newNode(x, pickHeight());
+		if (w->height > h) h = w->height;
+
+		Node* u = sentinel;
+		int j = -1;   // index of u
+
+		for (int r = h; r >= 0; r--) {
+			Link* l = u->links();
+			while (l[r].next != NULL && j + l[r].length < i) {
+				j += l[r].length;
+				u = l[r].next;
+				l = u->links();
+			}
+
+			// The link out of u at level r now jumps one more element
+			l[r].length++;
+
+			// If w is on this level, splice it in after u and split the
+			// length between u and w
+			if (r <= w->height) {
+				Link* wl = w->links();
+				wl[r].next = l[r].next;
+				l[r].next = w;
+				wl[r].length = l[r].length - (i - j);
+				l[r].length = i - j;
+			}
+		}
+		n++;
+	}
+
+	T remove(int i) {
+		assert(i >= 0 && i < n);
+
+		Node* u = sentinel;
+		Node* del = NULL;
+		int j = -1;   // index of u
+
+		for (int r = h; r >= 0; r--) {
+			Link* l = u->links();
+			while (l[r].next != NULL && j + l[r].length < i) {
+				j += l[r].length;
+				u = l[r].next;
+				l = u->links();
+			}
+
+			// The link out of u at level r now jumps one fewer element
+			l[r].length--;
+
+			// If the next node at this level is the one to remove, take over
+			// its link
+			if (j + l[r].length + 1 == i && l[r].next != NULL) {
+				del = l[r].next;
+				l[r].length += del->links()[r].length;
+				l[r].next = del->links()[r].next;
+
+				if (u == sentinel && l[r].next == NULL) h = r > 0 ? r - 1 : 0;
+			}
+		}
+
+		T x = del->x;
+		freeNode(del);
+		n--;
+		return x;
+	}
+
+	// === NODES ===
+
+	// A height h with probability 1/2^(h+1): the number of trailing one bits
+	// of a random number
+	int pickHeight() {
+		unsigned z = rng();
+		int k = 0;
+
+		for (unsigned m = 1; (z & m) != 0 && k < maxHeight - 1; m <<= 1) {
+			k++;
+		}
+		return k;
+	}
+
+	Node* newNode(const T& x, int height) {
+		void* p = pool.allocate(height, sizeof(Node) + (height + 1) * sizeof(Link));
+		Node* u = new (p) Node(x, height);
+
+		for (int r = 0; r <= height; r++) {
+			u->links()[r].next = NULL;
+			u->links()[r].length = 0;
+		}
+		return u;
+	}
+
+	void freeNode(Node* u) {
+		int height = u->height;
+		u->~Node();
+		pool.deallocate(u, height);
+	}
+
+	// === TESTING ===
+
+	void test() {
+		std::cout << "===" << std::endl;
+		std::cout << "4.3 | SkiplistList: An Efficient Random-Access List" << std::endl;
+		std::cout << "===" << std::endl;
+
+		this->add(0, 1);
+		std::cout << "SkiplistList.add(index: 0, value: 1)" << std::endl;
+		this->add(1, 2);
+		std::cout << "SkiplistList.add(index: 1, value: 2)" << std::endl;
+		this->add(1, 3);
+		std::cout << "SkiplistList.add(index: 1, value: 3)" << std::endl;
+		this->add(0, 4);
+		std::cout << "SkiplistList.add(index: 0, value: 4)" << std::endl;
+
+		this->printAllElements();
+
+		std::cout << "SkiplistList.remove(index: 2) = " << this->remove(2) << std::endl;
+
+		this->printAllElements();
+
+		this->set(1, 5);
+		std::cout << "SkiplistList.set(index: 1, value: 5)" << std::endl;
+		std::cout << "SkiplistList.get(index: 2) = " << this->get(2) << std::endl;
+
+		this->printAllElements();
+	}
+
+	// Adds, removes and gets at random positions in a list of 128K elements,
+	// against ArrayStack and DualArrayDeque
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "ArrayStack vs DualArrayDeque vs SkiplistList: random positions" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const int initial = 1 << 17;
+		const int ops = 1 << 15;
+
+		ArrayStack<T> stack;
+		DualArrayDeque<T> dual;
+		SkiplistList<T> skiplist;
+
+		for (int i = 0; i < initial; i++) {
+			stack.add(i, (T)i);
+			dual.add(i, (T)i);
+			skiplist.add(i, (T)i);
+		}
+
+		long stackSum = 0;
+		long dualSum = 0;
+		long skiplistSum = 0;
+		double stackSeconds = edit(stack, ops, stackSum);
+		double dualSeconds = edit(dual, ops, dualSum);
+		double skiplistSeconds = edit(skiplist, ops, skiplistSum);
+
+		bool agree = stackSum == skiplistSum && dualSum == skiplistSum && stack.size() == skiplist.size();
+
+		std::cout << ops << " adds/removes/gets on " << initial << " elements: ArrayStack " << stackSeconds
+		          << " s, DualArrayDeque " << dualSeconds << " s, SkiplistList " << skiplistSeconds << " s"
+		          << mismatch(agree) << std::endl;
+
+		stack.a.release();
+		dual.front.a.release();
+		dual.back.a.release();
+		std::cout << std::endl;
+	}
+
+	// Run the same random operations on any list, summing what get and remove
+	// return, and time them
+	template <typename List>
+	static double edit(List& list, int ops, long& sum) {
+		std::mt19937 random(13);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int k = 0; k < ops; k++) {
+			switch (k % 3) {
+			case 0: list.add(random() % (list.size() + 1), (T)k); break;
+			case 1: sum += list.remove(random() % list.size()); break;
+			case 2: sum += list.get(random() % list.size()); break;
+			}
+		}
+		return secondsSince(start);
+	}
+
+	void printAllElements() {
+		// Walk list 0 rather than calling get(i) for each index
+		Node* u = sentinel->links()[0].next;
+		printElements(n, [&u](OutputWriter& out, long) {
+			out << u->x;
+			u = u->links()[0].next;
+		});
+	}
+};
+
+#endif // SKIPLIST_LIST_HPP
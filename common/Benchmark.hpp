@@ -0,0 +1,18 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+
+// Helpers shared by the benchmark() functions
+
+// Seconds from start until now
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Ends a benchmark's line, marking it when the versions it compares disagree
+inline const char* mismatch(bool agree) {
+	return agree ? "" : " (MISMATCH)";
+}
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,351 @@
+#ifndef OUTPUT_WRITER_HPP
+#define OUTPUT_WRITER_HPP
+
+#include "Benchmark.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Buffers output in user space and writes it to a file descriptor in large
+// blocks, instead of flushing on every line like std::endl. Writes larger than
+// half the buffer are sent together with the buffered bytes in one writev call
+// rather than being copied. With a background thread, full buffers are handed
+// off and written while the caller keeps filling the other buffer.
+//
+// Nothing is written until the buffer fills, flush() is called or the writer
+// is destroyed, so call flush() before mixing in output from std::cout.
+//
+// A failed write (a closed pipe, a full disk) drops the rest of the output.
+// flush() returns false from then on, and finish() turns that into an exit
+// status.
+class OutputWriter {
+public:
+	int fd;
+	std::vector<char> buffer;
+	size_t used;
+
+	// Set by the first write that fails; nothing is written after it
+	bool failed;
+	int error;
+
+	// Background writer state: a full buffer waiting to be written
+	bool background;
+	std::vector<char> pending;
+	size_t pendingUsed;
+	bool stopping;
+	std::mutex lock;
+	std::condition_variable changed;
+	std::thread worker;
+
+	OutputWriter(int fd0 = STDOUT_FILENO, size_t capacity = 1 << 20, bool background0 = false)
+		: fd(fd0), buffer(capacity), used(0), failed(false), error(0), background(background0),
+		  pending(background0 ? capacity : 0), pendingUsed(0), stopping(false) {
+		if (background) worker = std::thread(&OutputWriter::run, this);
+	}
+
+	~OutputWriter() {
+		flush();
+
+		if (background) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+			changed.notify_all();
+			worker.join();
+		}
+	}
+
+	OutputWriter(const OutputWriter&) = delete;
+	OutputWriter& operator=(const OutputWriter&) = delete;
+
+	// === WRITING ===
+
+	void write(const char* p, size_t len) {
+		// Large writes skip the buffer and go out together with it
+		if (!background && len >= buffer.size() / 2) {
+			struct iovec iov[2];
+			iov[0].iov_base = buffer.data();
+			iov[0].iov_len = used;
+			iov[1].iov_base = (void*)p;
+			iov[1].iov_len = len;
+
+			writeAll(iov, 2);
+			used = 0;
+			return;
+		}
+
+		// Otherwise copy into the buffer, emptying it whenever it fills up
+		while (len > 0) {
+			if (used == buffer.size()) emptyBuffer();
+
+			size_t chunk = std::min(len, buffer.size() - used);
+			memcpy(buffer.data() + used, p, chunk);
+			used += chunk;
+			p += chunk;
+			len -= chunk;
+		}
+	}
+
+	void write(std::string_view s) {
+		write(s.data(), s.size());
+	}
+
+	void writeLine(std::string_view s) {
+		write(s.data(), s.size());
+		put('\n');
+	}
+
+	void put(char c) {
+		if (used == buffer.size()) emptyBuffer();
+		buffer[used++] = c;
+	}
+
+	OutputWriter& operator<<(std::string_view s) {
+		write(s.data(), s.size());
+		return *this;
+	}
+
+	OutputWriter& operator<<(const char* s) {
+		write(s, strlen(s));
+		return *this;
+	}
+
+	OutputWriter& operator<<(const std::string& s) {
+		write(s.data(), s.size());
+		return *this;
+	}
+
+	OutputWriter& operator<<(char c) {
+		put(c);
+		return *this;
+	}
+
+	// Numbers are formatted straight into the buffer with to_chars. Anything
+	// else goes through its stream operator.
+	template <typename T>
+	OutputWriter& operator<<(const T& x) {
+		if constexpr ((std::is_integral<T>::value && !std::is_same<T, bool>::value) ||
+		              std::is_floating_point<T>::value) {
+			char digits[64];
+			std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), x);
+			write(digits, r.ptr - digits);
+		} else {
+			std::ostringstream s;
+			s << x;
+			write(s.str());
+		}
+		return *this;
+	}
+
+	// === FLUSHING ===
+
+	// Write out everything buffered so far. With a background thread, this
+	// waits until the thread has written it. Returns false if any output has
+	// been lost to a failed write.
+	bool flush() {
+		if (!background) {
+			struct iovec iov = { buffer.data(), used };
+			writeAll(&iov, 1);
+			used = 0;
+			return !failed;
+		}
+
+		emptyBuffer();
+
+		std::unique_lock<std::mutex> guard(lock);
+		changed.wait(guard, [this]() { return pendingUsed == 0; });
+		return !failed;
+	}
+
+	// Flush at the end of a tool and return its exit status: 0, or 1 after
+	// reporting the error if any output was lost
+	int finish() {
+		if (flush()) return 0;
+
+		std::cerr << "Unable to write output: " << strerror(error) << std::endl;
+		return 1;
+	}
+
+	// Write a full buffer directly, or hand it to the background thread
+	void emptyBuffer() {
+		if (!background) {
+			flush();
+			return;
+		}
+
+		if (used == 0) return;
+
+		// Wait for the previous buffer to be written, then swap buffers
+		std::unique_lock<std::mutex> guard(lock);
+		changed.wait(guard, [this]() { return pendingUsed == 0; });
+
+		std::swap(buffer, pending);
+		pendingUsed = used;
+		used = 0;
+
+		guard.unlock();
+		changed.notify_all();
+	}
+
+	// Background thread: write each buffer handed off by emptyBuffer()
+	void run() {
+		std::unique_lock<std::mutex> guard(lock);
+
+		while (true) {
+			changed.wait(guard, [this]() { return pendingUsed > 0 || stopping; });
+			if (pendingUsed == 0) return;
+
+			// Write without holding the lock so the caller can keep filling
+			// its buffer
+			struct iovec iov = { pending.data(), pendingUsed };
+			guard.unlock();
+			writeAll(&iov, 1);
+			guard.lock();
+
+			pendingUsed = 0;
+			changed.notify_all();
+		}
+	}
+
+	// Write every byte described by iov, retrying after partial writes. The
+	// first error other than EINTR is recorded and the rest is dropped.
+	void writeAll(struct iovec* iov, int count) {
+		while (count > 0 && !failed) {
+			ssize_t written = writev(fd, iov, count);
+
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				error = errno;
+				failed = true;
+				return;
+			}
+
+			// Skip the buffers that were fully written, then trim the next one
+			while (count > 0 && (size_t)written >= iov->iov_len) {
+				written -= iov->iov_len;
+				iov++;
+				count--;
+			}
+			if (count > 0) {
+				iov->iov_base = (char*)iov->iov_base + written;
+				iov->iov_len -= written;
+			}
+		}
+	}
+
+	// === TESTING ===
+
+	// Lines per second to a pipe and to a file, written one write() per line
+	// (what std::endl costs), through an OutputWriter, and through one with a
+	// background thread
+	static void benchmark() {
+		std::cout << "===" << std::endl;
+		std::cout << "OutputWriter: lines/sec to a pipe and to a file" << std::endl;
+		std::cout << "===" << std::endl;
+
+		const long lines = 1 << 19;
+		const char* methods[] = { "write per line", "OutputWriter", "OutputWriter (background)" };
+
+		for (int method = 0; method < 3; method++) {
+			// A pipe, drained by another thread as a downstream process would
+			int ends[2];
+			if (pipe(ends) != 0) return;
+
+			long drained = 0;
+			std::thread reader([&ends, &drained]() {
+				std::vector<char> sink(1 << 16);
+				ssize_t got;
+				while ((got = read(ends[0], sink.data(), sink.size())) > 0) {
+					drained += got;
+				}
+			});
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			long bytes = writeLines(ends[1], method, lines);
+			close(ends[1]);
+			reader.join();
+			double pipeSeconds = secondsSince(start);
+			close(ends[0]);
+
+			// An anonymous temporary file
+			FILE* f = tmpfile();
+			if (f == NULL) return;
+
+			start = std::chrono::steady_clock::now();
+			writeLines(fileno(f), method, lines);
+			double fileSeconds = secondsSince(start);
+			fclose(f);
+
+			std::cout << methods[method] << ": pipe " << (long)(lines / pipeSeconds) << " lines/s, file "
+			          << (long)(lines / fileSeconds) << " lines/s" << mismatch(drained == bytes)
+			          << std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	// Write the benchmark's lines to fd by one of its methods, and return the
+	// number of bytes written
+	static long writeLines(int fd, int method, long lines) {
+		const char prefix[] = "The quick brown fox jumps over the lazy dog, line ";
+		char text[sizeof(prefix) + 24];
+		memcpy(text, prefix, sizeof(prefix) - 1);
+		long bytes = 0;
+
+		OutputWriter out(fd, 1 << 20, method == 2);
+		for (long k = 0; k < lines; k++) {
+			char* end = std::to_chars(text + sizeof(prefix) - 1, text + sizeof(text) - 1, k).ptr;
+			*end++ = '\n';
+			bytes += end - text;
+
+			if (method == 0) {
+				struct iovec iov = { text, (size_t)(end - text) };
+				out.writeAll(&iov, 1);
+			} else {
+				out.write(text, end - text);
+			}
+		}
+		out.flush();
+		return bytes;
+	}
+};
+
+// Shared writer for standard output, flushed when the program exits
+inline OutputWriter& stdoutWriter() {
+	static OutputWriter writer(STDOUT_FILENO);
+	return writer;
+}
+
+// Print "\t> Contains Elements: [...]" and a blank line to stdoutWriter(),
+// where print(out, i) writes element i of n, then flush so the elements come
+// out before any later std::cout output. This is what the containers'
+// printAllElements() do.
+template <typename Print>
+void printElements(long n, Print print) {
+	OutputWriter& out = stdoutWriter();
+	out << "\t> Contains Elements: [";
+
+	for (long i = 0; i < n; i++) {
+		if (i > 0) out << ", ";
+		print(out, i);
+	}
+	out << "]\n\n";
+	out.flush();
+}
+
+#endif // OUTPUT_WRITER_HPP
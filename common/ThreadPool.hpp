@@ -0,0 +1,150 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fork-join thread pool. run(count, fn) calls fn(0) ... fn(count-1) spread
+// over the workers and the calling thread, and returns once every call has
+// finished. Workers claim the next index with one atomic increment, so
+// uneven tasks balance themselves.
+//
+// One job runs at a time. A job started from inside a task runs serially on
+// that thread, so nested parallel code cannot deadlock the pool.
+class ThreadPool {
+public:
+	struct Job {
+		const std::function<void(long)>* fn;
+		long count;
+		std::atomic<long> next;
+		long done;    // tasks finished, under lock
+		int active;   // workers still inside the job, under lock
+
+		Job(const std::function<void(long)>* fn0, long count0)
+			: fn(fn0), count(count0), next(0), done(0), active(0) {}
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	std::mutex runLock;  // held by the thread whose job is running
+	Job* current;
+	long generation;     // bumped for every job, so workers join each once
+	bool stopping;
+
+	// The calling thread also works, so threads - 1 workers are started
+	ThreadPool(int threads = std::thread::hardware_concurrency())
+		: current(NULL), generation(0), stopping(false) {
+		for (int t = 1; t < threads; t++) {
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (size_t t = 0; t < workers.size(); t++) {
+			workers[t].join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads that run a job, including the caller
+	int size() {
+		return workers.size() + 1;
+	}
+
+	// A pool with a thread per core, started on first use
+	static ThreadPool& shared() {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	// === RUNNING ===
+
+	void run(long count, const std::function<void(long)>& fn) {
+		if (count <= 0) return;
+
+		if (workers.empty() || count == 1 || insideTask()) {
+			for (long k = 0; k < count; k++) {
+				fn(k);
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> one(runLock);
+		Job job(&fn, count);
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			current = &job;
+			generation++;
+		}
+		wake.notify_all();
+
+		long ran = work(job);
+
+		// job lives on this stack, so wait until no worker is still using it
+		std::unique_lock<std::mutex> guard(lock);
+		job.done += ran;
+		finished.wait(guard, [&job]() { return job.done == job.count && job.active == 0; });
+		current = NULL;
+	}
+
+	// Claim and run tasks of job until none are left. Returns how many ran.
+	long work(Job& job) {
+		long ran = 0;
+		insideTask() = true;
+
+		for (long k = job.next.fetch_add(1); k < job.count; k = job.next.fetch_add(1)) {
+			(*job.fn)(k);
+			ran++;
+		}
+
+		insideTask() = false;
+		return ran;
+	}
+
+	void workerLoop() {
+		long seen = 0;
+		std::unique_lock<std::mutex> guard(lock);
+
+		for (;;) {
+			wake.wait(guard, [this, &seen]() {
+				return stopping || (current != NULL && generation != seen);
+			});
+			if (stopping) return;
+
+			seen = generation;
+			Job& job = *current;
+			job.active++;
+
+			guard.unlock();
+			long ran = work(job);
+			guard.lock();
+
+			job.done += ran;
+			job.active--;
+			if (job.done == job.count && job.active == 0) finished.notify_all();
+		}
+	}
+
+	// True on a thread that is running a task
+	static bool& insideTask() {
+		thread_local bool inside = false;
+		return inside;
+	}
+};
+
+#endif // THREAD_POOL_HPP